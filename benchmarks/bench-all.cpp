@@ -0,0 +1,112 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#include "SafePtr.hpp"
+
+#include "construction.hpp"
+#include "pool.hpp"
+#include "fill-copy.hpp"
+#include "nd-view.hpp"
+#include "soa.hpp"
+#include "parallel.hpp"
+#include "serialization.hpp"
+#include "print.hpp"
+#include "comparison.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Usage: bench-all [--json FILE] [BENCHMARK...]
+// Runs the named benchmarks, or all of them, and writes the results to
+// FILE as JSON. In SAFE_PTR_DEBUG mode, only the comparison runs by
+// default, since the others measure code that is only fast without it.
+int main(int argc, char** argv)
+{
+    const char* json_path = nullptr;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    #ifdef SAFE_PTR_DEBUG
+        if (names.empty()) {
+            names.push_back("comparison");
+        }
+    #endif
+    const char* const known[] = {
+        "construction", "pool", "fill-copy", "nd-view", "soa", "parallel",
+        "serialization", "print", "comparison"
+    };
+    for (const auto& name : names) {
+        if (std::find(std::begin(known), std::end(known), name) ==
+            std::end(known)
+        ) {
+            std::cerr << "usage: bench-all [--json FILE] [BENCHMARK...]\n"
+                         "benchmarks:";
+            for (const char* const known_name : known) {
+                std::cerr << " " << known_name;
+            }
+            std::cerr << "\n";
+            return 1;
+        }
+    }
+    const auto is_selected = [&](const char* const name) {
+        return names.empty() ||
+            std::find(names.begin(), names.end(), name) != names.end();
+    };
+
+    std::cout << "========================================\n";
+    #if defined(SAFE_PTR_DEBUG) && defined(SAFE_PTR_DEBUG_INLINE_HEADER)
+        const char* const mode = "debug-header";
+        std::cout << "Benchmarking with SAFE_PTR_DEBUG mode ON (inline "
+                     "header):\n";
+    #elif defined(SAFE_PTR_DEBUG)
+        const char* const mode = "debug";
+        std::cout << "Benchmarking with SAFE_PTR_DEBUG mode ON:\n";
+    #else
+        const char* const mode = "release";
+        std::cout << "Benchmarking with SAFE_PTR_DEBUG mode OFF:\n";
+    #endif
+    if (is_selected("construction")) {
+        bench_construction();
+    }
+    if (is_selected("pool")) {
+        bench_pool();
+    }
+    if (is_selected("fill-copy")) {
+        bench_fill_copy();
+    }
+    if (is_selected("nd-view")) {
+        bench_nd_view();
+    }
+    if (is_selected("soa")) {
+        bench_soa();
+    }
+    if (is_selected("parallel")) {
+        bench_parallel();
+    }
+    if (is_selected("serialization")) {
+        bench_serialization();
+    }
+    if (is_selected("print")) {
+        bench_print();
+    }
+    if (is_selected("comparison")) {
+        bench_comparison();
+    }
+
+    if (json_path != nullptr) {
+        std::ofstream file(json_path);
+        write_json(file, mode);
+        if (!file) {
+            std::cerr << "could not write " << json_path << "\n";
+            return 1;
+        }
+    }
+}
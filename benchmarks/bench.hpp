@@ -0,0 +1,149 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Keeps the compiler from optimizing away the computation of `value`.
+template<typename T>
+void do_not_optimize(const T& value)
+{
+    #if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+    #else
+        static volatile const void* sink;
+        sink = &value;
+    #endif
+}
+
+// Runs `f` `repetitions` times and returns the fastest run in seconds.
+template<typename F>
+double measure(F f, const size_t repetitions = 5)
+{
+    double best = 0;
+    for (size_t i = 0; i != repetitions; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto stop = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(stop-start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// Like measure(), but runs `setup` before each run of `f` without timing
+// it.
+template<typename S, typename F>
+double measure_after(S setup, F f, const size_t repetitions = 5)
+{
+    double best = 0;
+    for (size_t i = 0; i != repetitions; ++i) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto stop = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(stop-start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// One line printed by report(), kept for write_json().
+struct BenchResult
+{
+    std::string section;
+    std::string name;
+    size_t size;
+    double seconds;
+};
+
+inline std::vector<BenchResult>& get_results()
+{
+    static std::vector<BenchResult> results;
+    return results;
+}
+
+// Titles of the sections the next results belong to, outermost first.
+inline std::vector<std::string>& get_sections()
+{
+    static std::vector<std::string> sections;
+    return sections;
+}
+
+// Prints the title of a section of results, nested in the last section of
+// `depth - 1`.
+void section(const std::string& title, const size_t depth = 0)
+{
+    std::cout << std::string(2 * depth, ' ') << title << ":\n";
+    std::vector<std::string>& sections = get_sections();
+    sections.resize(std::min(depth, sections.size()));
+    sections.push_back(title);
+}
+
+void report(const char* const name, const size_t size, const double seconds)
+{
+    std::cout << "    " << std::left << std::setw(48) << name
+              << std::right << std::setw(10) << size << " elements: "
+              << std::fixed << std::setprecision(3) << seconds * 1e3
+              << " ms\n";
+    std::string path;
+    for (const std::string& title : get_sections()) {
+        path += path.empty() ? title : " / " + title;
+    }
+    get_results().push_back(BenchResult{path, name, size, seconds});
+}
+
+void write_json_string(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                << static_cast<int>(c) << std::dec << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Writes every result reported so far as JSON, with the build they were
+// measured with, so results of different versions can be compared.
+void write_json(std::ostream& out, const std::string& mode)
+{
+    out << "{\n  \"mode\": ";
+    write_json_string(out, mode);
+    out << ",\n  \"compiler\": ";
+    #if defined(__clang__)
+        write_json_string(out, "clang " __clang_version__);
+    #elif defined(__GNUC__)
+        write_json_string(out, "gcc " __VERSION__);
+    #elif defined(_MSC_VER)
+        write_json_string(out, "msvc " + std::to_string(_MSC_FULL_VER));
+    #else
+        write_json_string(out, "unknown");
+    #endif
+    out << ",\n  \"results\": [";
+    const std::vector<BenchResult>& results = get_results();
+    for (size_t i = 0; i != results.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n") << "    {\"section\": ";
+        write_json_string(out, results[i].section);
+        out << ", \"name\": ";
+        write_json_string(out, results[i].name);
+        out << ", \"size\": " << results[i].size << ", \"seconds\": "
+            << std::scientific << std::setprecision(6) << results[i].seconds
+            << std::defaultfloat << "}";
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,320 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include "construction.hpp"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The containers fz::SafePtr is compared with, behind the same interface.
+// `make` fills `size` elements with `value`, `copy` makes a new container
+// with the elements of another and `release` gives the memory back.
+
+template<typename T>
+struct NewArray
+{
+    using Type = T*;
+    static constexpr bool has_at = false;
+
+    static const char* name() { return "new T[]"; }
+
+    static T* make(const size_t size, const T& value) {
+        T* const data = new T[size];
+        std::fill(data, data + size, value);
+        return data;
+    }
+
+    static T* copy(T* const& other, const size_t size) {
+        T* const data = new T[size];
+        std::copy(other, other + size, data);
+        return data;
+    }
+
+    static void fill(T* const data, const size_t size, const T& value) {
+        std::fill(data, data + size, value);
+    }
+
+    static T& get(T* const data, const size_t index) {
+        return data[index];
+    }
+
+    static void release(T*& data) {
+        delete[] data;
+        data = nullptr;
+    }
+};
+
+template<typename T>
+struct UniqueArray
+{
+    using Type = std::unique_ptr<T[]>;
+    static constexpr bool has_at = false;
+
+    static const char* name() { return "std::unique_ptr<T[]>"; }
+
+    static Type make(const size_t size, const T& value) {
+        Type data(new T[size]);
+        std::fill(data.get(), data.get() + size, value);
+        return data;
+    }
+
+    static Type copy(const Type& other, const size_t size) {
+        Type data(new T[size]);
+        std::copy(other.get(), other.get() + size, data.get());
+        return data;
+    }
+
+    static void fill(Type& data, const size_t size, const T& value) {
+        std::fill(data.get(), data.get() + size, value);
+    }
+
+    static T& get(Type& data, const size_t index) {
+        return data[index];
+    }
+
+    static void release(Type& data) {
+        data.reset();
+    }
+};
+
+template<typename T>
+struct Vector
+{
+    using Type = std::vector<T>;
+    static constexpr bool has_at = true;
+
+    static const char* name() { return "std::vector<T>"; }
+
+    static Type make(const size_t size, const T& value) {
+        return Type(size, value);
+    }
+
+    static Type copy(const Type& other, size_t) {
+        return other;
+    }
+
+    static void fill(Type& data, size_t, const T& value) {
+        std::fill(data.begin(), data.end(), value);
+    }
+
+    static T& get(Type& data, const size_t index) {
+        return data[index];
+    }
+
+    static T& at(Type& data, const size_t index) {
+        return data.at(index);
+    }
+
+    static void release(Type& data) {
+        Type().swap(data);
+    }
+};
+
+template<typename T>
+struct SafePtrArray
+{
+    using Type = fz::SafePtr<T>;
+    static constexpr bool has_at = true;
+
+    static const char* name() { return "fz::SafePtr<T>"; }
+
+    static Type make(const size_t size, const T& value) {
+        return Type(size, value);
+    }
+
+    static Type copy(const Type& other, size_t) {
+        return Type(other);
+    }
+
+    static void fill(Type& data, size_t, const T& value) {
+        data.fill(value);
+    }
+
+    static T& get(Type& data, const size_t index) {
+        return data[index];
+    }
+
+    static T& at(Type& data, const size_t index) {
+        return data.at(index);
+    }
+
+    static void release(Type& data) {
+        data.free();
+    }
+};
+
+inline double value_of(const double value)
+{
+    return value;
+}
+
+inline double value_of(const Particle& particle)
+{
+    return particle.position[0];
+}
+
+template<typename A, typename T>
+double sum_with_at(typename A::Type& data, const size_t size, std::true_type)
+{
+    double sum = 0;
+    for (size_t i = 0; i != size; ++i) {
+        sum += value_of(A::at(data, i));
+    }
+    return sum;
+}
+
+template<typename A, typename T>
+double sum_with_at(typename A::Type&, size_t, std::false_type)
+{
+    return 0;
+}
+
+// Times every operation on `count` containers of `size` elements each.
+template<typename A, typename T>
+void bench_container(const size_t size, const size_t count, const T& value)
+{
+    using Type = typename A::Type;
+    const std::string name = A::name();
+    std::vector<Type> containers(count);
+    const auto make_all = [&](){
+        for (auto& container : containers) {
+            container = A::make(size, value);
+        }
+    };
+    const auto release_all = [&](){
+        for (auto& container : containers) {
+            A::release(container);
+        }
+    };
+
+    make_all(); // so there is something to release before each run
+    report((name + " construction").c_str(), size, measure_after(
+        release_all, make_all
+    ));
+    std::vector<Type> copies(count);
+    report((name + " copy").c_str(), size, measure([&](){
+        for (size_t i = 0; i != count; ++i) {
+            copies[i] = A::copy(containers[i], size);
+        }
+        do_not_optimize(A::get(copies[count-1], size-1));
+        for (auto& copy : copies) {
+            A::release(copy);
+        }
+    }));
+    report((name + " move").c_str(), size, measure([&](){
+        for (auto& container : containers) {
+            Type moved = std::move(container);
+            container = std::move(moved);
+        }
+        do_not_optimize(A::get(containers[count-1], size-1));
+    }));
+    report((name + " fill").c_str(), size, measure([&](){
+        for (auto& container : containers) {
+            A::fill(container, size, value);
+        }
+        do_not_optimize(A::get(containers[count-1], size-1));
+    }));
+    report((name + " operator[]").c_str(), size, measure([&](){
+        double sum = 0;
+        for (auto& container : containers) {
+            for (size_t i = 0; i != size; ++i) {
+                sum += value_of(A::get(container, i));
+            }
+        }
+        do_not_optimize(sum);
+    }));
+    if (A::has_at) {
+        report((name + " at()").c_str(), size, measure([&](){
+            double sum = 0;
+            for (auto& container : containers) {
+                sum += sum_with_at<A, T>(
+                    container, size, std::integral_constant<bool, A::has_at>{}
+                );
+            }
+            do_not_optimize(sum);
+        }));
+    }
+    release_all();
+    report((name + " free").c_str(), size, measure_after(
+        make_all, release_all
+    ));
+}
+
+// Makes, sums and releases containers in `thread_count` threads at once,
+// which shows how much the threads slow each other down.
+template<typename A, typename T>
+void bench_threads(
+    const size_t thread_count, const size_t size, const size_t count,
+    const T& value
+) {
+    const std::string name =
+        std::string(A::name()) + " make, sum and release";
+    report(name.c_str(), size, measure([&](){
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t != thread_count; ++t) {
+            threads.emplace_back([&](){
+                double sum = 0;
+                for (size_t i = 0; i != count; ++i) {
+                    typename A::Type data = A::make(size, value);
+                    for (size_t j = 0; j != size; ++j) {
+                        sum += value_of(A::get(data, j));
+                    }
+                    A::release(data);
+                }
+                do_not_optimize(sum);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }));
+}
+
+// Every run touches about `total` elements, whatever the size of the
+// containers, so the times of different sizes can be compared.
+template<typename T>
+void bench_comparison_of(const char* const type_name, const T& value)
+{
+    constexpr size_t total = 1 << 20;
+    const size_t sizes[] = {16, 1024, 1 << 16, 1 << 20};
+    section(
+        std::string("Comparison, ") + type_name + ", " +
+            std::to_string(total) + " elements per run"
+    );
+    for (const size_t size : sizes) {
+        section(std::to_string(size) + " elements per container", 1);
+        const size_t count = total / size;
+        bench_container<NewArray<T>>(size, count, value);
+        bench_container<UniqueArray<T>>(size, count, value);
+        bench_container<Vector<T>>(size, count, value);
+        bench_container<SafePtrArray<T>>(size, count, value);
+    }
+
+    const size_t max_threads = std::max<size_t>(
+        std::thread::hardware_concurrency(), 1
+    );
+    for (const size_t thread_count : {size_t(1), max_threads}) {
+        section(std::to_string(thread_count) + " thread(s)", 1);
+        constexpr size_t size = 64;
+        bench_threads<NewArray<T>>(thread_count, size, total / size, value);
+        bench_threads<Vector<T>>(thread_count, size, total / size, value);
+        bench_threads<SafePtrArray<T>>(
+            thread_count, size, total / size, value
+        );
+        if (max_threads == 1) {
+            break;
+        }
+    }
+}
+
+void bench_comparison()
+{
+    bench_comparison_of<double>("double", 1.0);
+    bench_comparison_of<Particle>("Particle", Particle(1.0));
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <string>
+#include <algorithm>
+
+// A small struct with a non trivial default constructor.
+struct Particle
+{
+    double position[3];
+    double velocity[3];
+
+    Particle() : position{0, 0, 0}, velocity{0, 0, 0} {}
+    Particle(const double v) : position{v, v, v}, velocity{v, v, v} {}
+};
+
+// Compares constructing every element in place with default constructing
+// and then assigning, which is what `new T[]` followed by a fill does.
+template<typename T>
+void bench_construction_of(
+    const char* const type_name, const size_t size, const T& value
+) {
+    section(type_name);
+
+    report("new T[] + std::fill", size, measure([&](){
+        T* data = new T[size];
+        std::fill(data, data + size, value);
+        do_not_optimize(data[size-1]);
+        delete[] data;
+    }));
+
+    report("fz::SafePtr<T>(size, value)", size, measure([&](){
+        fz::SafePtr<T> ptr(size, value);
+        do_not_optimize(ptr[size-1]);
+        ptr.free();
+    }));
+
+    T* source = new T[size];
+    std::fill(source, source + size, value);
+
+    report("new T[] + std::copy", size, measure([&](){
+        T* data = new T[size];
+        std::copy(source, source + size, data);
+        do_not_optimize(data[size-1]);
+        delete[] data;
+    }));
+
+    report("fz::SafePtr<T>(first, last)", size, measure([&](){
+        fz::SafePtr<T> ptr(source, source + size);
+        do_not_optimize(ptr[size-1]);
+        ptr.free();
+    }));
+
+    delete[] source;
+}
+
+void bench_construction()
+{
+    constexpr size_t size = 1 << 20;
+    bench_construction_of<double>("double", size, 1.0);
+    bench_construction_of<Particle>("Particle", size, Particle(1.0));
+    bench_construction_of<std::string>(
+        "std::string", size, std::string(32, 'x')
+    );
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <algorithm>
+
+// 12 bytes, which compilers do not vectorize std::fill() for
+struct Vec3
+{
+    float x, y, z;
+};
+
+// Compares fill() and copies with the loops they replaced, for a buffer
+// that fits in the cache and one that does not.
+template<typename T>
+void bench_fill_copy_of(const char* const type_name, const T& value)
+{
+    section(type_name);
+    const size_t sizes[] = {
+        (256 * 1024) / sizeof(T), (256 * 1024 * 1024) / sizeof(T)
+    };
+    for (const size_t size : sizes) {
+        fz::SafePtr<T> source(size, value);
+
+        report("element by element fill", size, measure([&](){
+            for (auto& element : source) {
+                element = value;
+            }
+            do_not_optimize(source[size-1]);
+        }));
+
+        report("fz::SafePtr<T>::fill", size, measure([&](){
+            source.fill(value);
+            do_not_optimize(source[size-1]);
+        }));
+
+        report("new T[] + std::copy", size, measure([&](){
+            T* data = new T[size];
+            std::copy(source.begin(), source.end(), data);
+            do_not_optimize(data[size-1]);
+            delete[] data;
+        }));
+
+        report("fz::SafePtr<T> copy constructor", size, measure([&](){
+            fz::SafePtr<T> copy = source;
+            do_not_optimize(copy[size-1]);
+            copy.free();
+        }));
+
+        source.free();
+    }
+}
+
+void bench_fill_copy()
+{
+    bench_fill_copy_of<double>("double", 1.5);
+    bench_fill_copy_of<Vec3>("Vec3", Vec3{1.0f, 2.0f, 3.0f});
+}
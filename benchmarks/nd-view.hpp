@@ -0,0 +1,93 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <algorithm>
+
+// Multiplies n x n matrices (c += a * b) with hand computed indices, with
+// SafePtr2D indices, with rows from span() and with tiles from tile().
+void bench_nd_view()
+{
+    constexpr size_t n = 1024;
+    constexpr size_t tile_size = 64;
+    section(
+        "Matrix multiplication, " + std::to_string(n) + " x " +
+            std::to_string(n)
+    );
+    fz::SafePtr<float> a(n * n, 1.0f);
+    fz::SafePtr<float> b(n * n, 2.0f);
+    fz::SafePtr<float> c(n * n, 0.0f);
+
+    report("hand computed indices", n * n, measure([&](){
+        for (size_t i = 0; i != n; ++i) {
+            for (size_t k = 0; k != n; ++k) {
+                for (size_t j = 0; j != n; ++j) {
+                    c[i*n + j] += a[i*n + k] * b[k*n + j];
+                }
+            }
+        }
+        do_not_optimize(c[0]);
+    }, 3));
+
+    fz::SafePtr2D<float> a2(a, {n, n});
+    fz::SafePtr2D<float> b2(b, {n, n});
+    fz::SafePtr2D<float> c2(c, {n, n});
+    report("fz::SafePtr2D::operator()", n * n, measure([&](){
+        for (size_t i = 0; i != n; ++i) {
+            for (size_t k = 0; k != n; ++k) {
+                for (size_t j = 0; j != n; ++j) {
+                    c2(i, j) += a2(i, k) * b2(k, j);
+                }
+            }
+        }
+        do_not_optimize(c[0]);
+    }, 3));
+
+    report("fz::SafePtr2D::span", n * n, measure([&](){
+        for (size_t i = 0; i != n; ++i) {
+            const auto a_row = a2.span(i);
+            const auto c_row = c2.span(i);
+            for (size_t k = 0; k != n; ++k) {
+                const auto b_row = b2.span(k);
+                const float a_ik = a_row[k];
+                for (size_t j = 0; j != n; ++j) {
+                    c_row[j] += a_ik * b_row[j];
+                }
+            }
+        }
+        do_not_optimize(c[0]);
+    }, 3));
+
+    // every tile of c is computed while it stays in the cache
+    using Tiled = fz::SafePtr2D<float, fz::LayoutTiled<tile_size, tile_size>>;
+    Tiled at(a, {n, n});
+    Tiled bt(b, {n, n});
+    Tiled ct(c, {n, n});
+    const size_t tiles = ct.tile_count(0);
+    report("fz::SafePtr2D<LayoutTiled>::tile", n * n, measure([&](){
+        for (size_t ti = 0; ti != tiles; ++ti) {
+            for (size_t tj = 0; tj != tiles; ++tj) {
+                const auto c_tile = ct.tile(ti, tj);
+                for (size_t tk = 0; tk != tiles; ++tk) {
+                    const auto a_tile = at.tile(ti, tk);
+                    const auto b_tile = bt.tile(tk, tj);
+                    for (size_t i = 0; i != tile_size; ++i) {
+                        for (size_t k = 0; k != tile_size; ++k) {
+                            const float a_ik = a_tile[i*tile_size + k];
+                            for (size_t j = 0; j != tile_size; ++j) {
+                                c_tile[i*tile_size + j] +=
+                                    a_ik * b_tile[k*tile_size + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        do_not_optimize(c[0]);
+    }, 3));
+
+    a.free();
+    b.free();
+    c.free();
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compares the fz::parallel algorithms with sequential loops, with 1 up to
+// std::thread::hardware_concurrency() threads.
+void bench_parallel()
+{
+    constexpr size_t size = 32 * 1024 * 1024;
+    section("Parallel algorithms");
+    fz::SafePtr<double> input(size, 1.0);
+    fz::SafePtr<double> output(size, 0.0);
+
+    report("std::accumulate", size, measure([&](){
+        do_not_optimize(std::accumulate(input.begin(), input.end(), 0.0));
+    }));
+    report("std::partial_sum", size, measure([&](){
+        std::partial_sum(input.begin(), input.end(), output.begin());
+        do_not_optimize(output[size-1]);
+    }));
+
+    // 1, 2, 4, ... and the number of hardware threads
+    const size_t max_threads = std::max<size_t>(
+        std::thread::hardware_concurrency(), 1
+    );
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for (const size_t threads : thread_counts) {
+        fz::ThreadPool pool(threads);
+        const std::string suffix = ", " + std::to_string(threads) + " threads";
+        report(("fz::parallel::reduce" + suffix).c_str(), size, measure([&](){
+            do_not_optimize(fz::parallel::reduce(input, 0.0, pool));
+        }));
+        report(("fz::parallel::inclusive_scan" + suffix).c_str(), size,
+            measure([&](){
+                fz::parallel::inclusive_scan(
+                    input, output, std::plus<double>(), pool
+                );
+                do_not_optimize(output[size-1]);
+            })
+        );
+        report(("fz::parallel::transform" + suffix).c_str(), size,
+            measure([&](){
+                fz::parallel::transform(input, output, [](double value) {
+                    return value * 2.0 + 1.0;
+                }, pool);
+                do_not_optimize(output[size-1]);
+            })
+        );
+    }
+
+    input.free();
+    output.free();
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <thread>
+#include <vector>
+
+// Every thread keeps a window of live allocations of 4 to 256 ints and
+// replaces one of them at each step. At the end, each window is freed by the
+// next thread, so with more than one thread the last allocations are freed by
+// a thread other than the one that made them.
+template<typename Alloc>
+void churn(const size_t thread_count, const size_t steps)
+{
+    using Ints = fz::SafePtr<int, alignof(int), Alloc>;
+    constexpr size_t window = 64;
+
+    std::vector<std::vector<Ints>> windows(thread_count);
+    for (auto& ptrs : windows) {
+        ptrs.reserve(window);
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t != thread_count; ++t) {
+        threads.push_back(std::thread([&windows, t, steps](){
+            std::vector<Ints>& ptrs = windows[t];
+            size_t size = 4;
+            for (size_t i = 0; i != steps; ++i) {
+                size = size * 7 % 253 + 4;
+                if (ptrs.size() < window) {
+                    ptrs.push_back(Ints(size, 0));
+                } else {
+                    Ints& ptr = ptrs[i % window];
+                    ptr.free();
+                    ptr = Ints(size, static_cast<int>(i));
+                }
+                do_not_optimize(ptrs.back()[0]);
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    threads.clear();
+    for (size_t t = 0; t != thread_count; ++t) {
+        threads.push_back(std::thread([&windows, t, thread_count](){
+            for (auto& ptr : windows[(t + 1) % thread_count]) {
+                ptr.free();
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void bench_pool()
+{
+    constexpr size_t steps = 1 << 20;
+    section(
+        "small allocations, " + std::to_string(steps) + " steps per thread"
+    );
+    for (size_t thread_count = 1; thread_count <= 4; thread_count *= 2) {
+        section(std::to_string(thread_count) + " thread(s)", 1);
+        report("fz::DefaultAllocator", steps, measure([&](){
+            churn<fz::DefaultAllocator>(thread_count, steps);
+        }));
+        report("fz::PoolAllocator", steps, measure([&](){
+            churn<fz::PoolAllocator>(thread_count, steps);
+        }));
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <sstream>
+
+// Compares print() with writing the same lines element by element with
+// `std::ostream <<`, as print() used to. Both write to a std::ostringstream,
+// so the terminal does not take part.
+template<typename T>
+void bench_print_of(const char* const type_name, const T& value)
+{
+    section(type_name);
+    const size_t size = 1000000;
+    fz::SafePtr<T> source(size, value);
+
+    report("std::ostream << per element", size, measure([&](){
+        std::ostringstream out;
+        out << "source: {\n";
+        for (size_t i = 0; i != size; ++i) {
+            out << "    " << i << ": " << source[i] << ",\n";
+        }
+        out << "}\n";
+        do_not_optimize(out.tellp());
+    }));
+
+    report("fz::SafePtr<T>::print, lines", size, measure([&](){
+        std::ostringstream out;
+        source.print(out, fz::PrintFormat::all(), "source");
+        do_not_optimize(out.tellp());
+    }));
+
+    report("fz::SafePtr<T>::print, csv", size, measure([&](){
+        std::ostringstream out;
+        source.print(out, fz::PrintFormat::all(fz::PrintLayout::csv));
+        do_not_optimize(out.tellp());
+    }));
+
+    source.free();
+}
+
+void bench_print()
+{
+    bench_print_of<int>("int", 123456);
+    bench_print_of<double>("double", 0.1);
+}
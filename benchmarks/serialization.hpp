@@ -0,0 +1,51 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+// Compares save() and load() with writing and reading the same doubles with
+// file streams. The file is in the page cache, so it measures the copies
+// and the system calls and not the disk.
+void bench_serialization()
+{
+    #if defined(__unix__) || defined(__APPLE__)
+        section("serialization");
+        const char* const path = "safe-ptr-bench-serialization.bin";
+        const size_t size = (64 * 1024 * 1024) / sizeof(double);
+        fz::SafePtr<double> source(size, 1.5);
+
+        report("std::ofstream::write", size, measure([&](){
+            std::ofstream file(path, std::ios::binary);
+            file.write(
+                reinterpret_cast<const char*>(source.data()),
+                size * sizeof(double)
+            );
+        }));
+
+        report("std::vector + std::ifstream::read", size, measure([&](){
+            std::ifstream file(path, std::ios::binary);
+            std::vector<double> loaded(size);
+            file.read(
+                reinterpret_cast<char*>(loaded.data()), size * sizeof(double)
+            );
+            do_not_optimize(loaded[size-1]);
+        }));
+
+        report("fz::SafePtr<T>::save", size, measure([&](){
+            source.save(path);
+        }));
+
+        report("fz::SafePtr<T>::load", size, measure([&](){
+            fz::SafePtr<double> loaded = fz::SafePtr<double>::load(path);
+            do_not_optimize(loaded[size-1]);
+            loaded.free();
+        }));
+
+        source.free();
+        std::remove(path);
+    #endif
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "bench.hpp"
+
+struct Body
+{
+    float x, y, z;
+    float vx, vy, vz;
+    float mass;
+    int id;
+};
+
+// Sums one field of every record, which reads every field from memory with
+// an array of structs and only that field with a structure of arrays.
+void bench_soa()
+{
+    constexpr size_t size = 8 * 1024 * 1024;
+    section(
+        "Sum of one field of " + std::to_string(sizeof(Body)) +
+            " byte records"
+    );
+    fz::SafePtr<Body> aos(size, Body{1, 2, 3, 4, 5, 6, 0.5f, 7});
+    using Bodies = fz::SafeSoA<
+        float, float, float, float, float, float, float, int
+    >;
+    Bodies soa(size, 1, 2, 3, 4, 5, 6, 0.5f, 7);
+
+    report("fz::SafePtr<Body>", size, measure([&](){
+        float sum = 0;
+        for (const Body& body : aos) {
+            sum += body.mass;
+        }
+        do_not_optimize(sum);
+    }));
+
+    report("fz::SafeSoA::operator[]", size, measure([&](){
+        float sum = 0;
+        for (size_t i = 0; i != size; ++i) {
+            sum += std::get<6>(soa[i]);
+        }
+        do_not_optimize(sum);
+    }));
+
+    report("fz::SafeSoA::column", size, measure([&](){
+        float sum = 0;
+        for (const float mass : soa.column<6>()) {
+            sum += mass;
+        }
+        do_not_optimize(sum);
+    }));
+
+    aos.free();
+    soa.free();
+}
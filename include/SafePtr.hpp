@@ -8,12 +8,80 @@
     #define SAFE_PTR_DEBUG_BOOL 0
 #endif
 
+#if defined(SAFE_PTR_DEBUG) && defined(SAFE_PTR_DEBUG_INLINE_HEADER)
+    #define SAFE_PTR_INLINE_HEADER_BOOL 1
+#else
+    #define SAFE_PTR_INLINE_HEADER_BOOL 0
+#endif
+
+#ifdef SAFE_PTR_STATS
+    #define SAFE_PTR_STATS_BOOL 1
+#else
+    #define SAFE_PTR_STATS_BOOL 0
+#endif
+
+#ifndef SAFE_PTR_STATS_MAX_TYPES
+    #define SAFE_PTR_STATS_MAX_TYPES 64
+#endif
+
+#ifndef SAFE_PTR_STATS_FLUSH_BYTES
+    #define SAFE_PTR_STATS_FLUSH_BYTES (256 * 1024)
+#endif
+
 #ifdef SAFE_PTR_TEST
     #define SAFE_PTR_TEST_BOOL 1
 #else
     #define SAFE_PTR_TEST_BOOL 0
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+    #define SAFE_PTR_POSIX_BOOL 1
+#else
+    #define SAFE_PTR_POSIX_BOOL 0
+#endif
+
+#if defined(SAFE_PTR_LARGE_ALLOC_THRESHOLD) && SAFE_PTR_POSIX_BOOL
+    #define SAFE_PTR_LARGE_ALLOC_BOOL 1
+#else
+    #define SAFE_PTR_LARGE_ALLOC_BOOL 0
+#endif
+
+#ifndef SAFE_PTR_HUGE_PAGE_SIZE
+    #define SAFE_PTR_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+#if !defined(SAFE_PTR_DISABLE_SIMD) && \
+    (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+    #define SAFE_PTR_SIMD_BOOL 1
+#else
+    #define SAFE_PTR_SIMD_BOOL 0
+#endif
+
+#ifndef SAFE_PTR_STREAMING_THRESHOLD
+    #define SAFE_PTR_STREAMING_THRESHOLD (8 * 1024 * 1024)
+#endif
+
+#ifndef SAFE_PTR_PARALLEL_CHUNK_BYTES
+    #define SAFE_PTR_PARALLEL_CHUNK_BYTES (64 * 1024)
+#endif
+
+// whether AllocationSite can default to the location of the caller
+#if defined(__GNUC__) && !defined(__clang__)
+    #define SAFE_PTR_SITE_BOOL 1
+#elif defined(__clang__) && defined(__has_builtin)
+    #if __has_builtin(__builtin_FILE) && __has_builtin(__builtin_LINE) && \
+        __has_builtin(__builtin_FUNCTION)
+        #define SAFE_PTR_SITE_BOOL 1
+    #else
+        #define SAFE_PTR_SITE_BOOL 0
+    #endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1926
+    #define SAFE_PTR_SITE_BOOL 1
+#else
+    #define SAFE_PTR_SITE_BOOL 0
+#endif
+
 #define SAFE_PTR_WARNING(msg) _warning(msg, __FILE__, __LINE__, __func__)
 
 #include <iostream>
@@ -21,9 +89,74 @@
 #include <stdexcept>
 #include <iterator>
 #include <type_traits>
+#include <memory>
+#include <new>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <tuple>
+#include <functional>
+#if SAFE_PTR_SIMD_BOOL
+    #include <immintrin.h>
+#endif
+#if SAFE_PTR_POSIX_BOOL
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <climits>
+#endif
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <system_error>
+#include <utility>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
 #if SAFE_PTR_DEBUG_BOOL
     #include <unordered_map>
-    #include <mutex>
+#endif
+#if SAFE_PTR_DEBUG_BOOL || SAFE_PTR_STATS_BOOL
+    #include <typeinfo>
+    #if defined(__GNUC__) || defined(__clang__)
+        #include <cxxabi.h>
+    #endif
+#endif
+
+#if SAFE_PTR_DEBUG_BOOL && defined(SAFE_PTR_DEBUG_BACKTRACE) && \
+    (defined(__GLIBC__) || defined(__APPLE__))
+    #define SAFE_PTR_BACKTRACE_BOOL 1
+    #include <execinfo.h>
+    #ifndef SAFE_PTR_DEBUG_BACKTRACE_DEPTH
+        #define SAFE_PTR_DEBUG_BACKTRACE_DEPTH 16
+    #endif
+#else
+    #define SAFE_PTR_BACKTRACE_BOOL 0
+#endif
+
+#if SAFE_PTR_DEBUG_BOOL && defined(SAFE_PTR_DEBUG_QUARANTINE)
+    #define SAFE_PTR_QUARANTINE_BOOL 1
+    #ifndef SAFE_PTR_DEBUG_QUARANTINE_BYTES
+        #define SAFE_PTR_DEBUG_QUARANTINE_BYTES (16 * 1024 * 1024)
+    #endif
+    #ifndef SAFE_PTR_DEBUG_QUARANTINE_COUNT
+        #define SAFE_PTR_DEBUG_QUARANTINE_COUNT 1024
+    #endif
+    #ifndef SAFE_PTR_DEBUG_GUARD_BYTES
+        #define SAFE_PTR_DEBUG_GUARD_BYTES 16
+    #endif
+#else
+    #define SAFE_PTR_QUARANTINE_BOOL 0
 #endif
 
 namespace fz {
@@ -32,511 +165,5925 @@ namespace fz {
     struct _SafePtrWarning {};
 #endif
 
-template<typename T>
-class SafePtr
-{
-public:
-    // constructor
-    SafePtr() {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            _memory_id = _get_new_memory_id();
-            _ref_count[_memory_id] = 1;
-            _is_deleted[_memory_id] = true;
-        #endif
+#if SAFE_PTR_POSIX_BOOL
+    inline size_t _get_page_size() {
+        static const size_t page_size = static_cast<size_t>(
+            sysconf(_SC_PAGESIZE)
+        );
+        return page_size;
     }
 
-    // constructor
-    SafePtr(const size_t size) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            _memory_id = _get_new_memory_id();
-            _ref_count[_memory_id] = 1;
-            _is_deleted[_memory_id] = false;
-        #endif
-        _begin = new T[size];
-        _end = _begin + size;
+    inline size_t _get_mapping_length(const size_t bytes) {
+        const size_t page_size = _get_page_size();
+        return (bytes + page_size - 1) / page_size * page_size;
     }
+#endif
 
-    // constructor
-    SafePtr(const size_t size, const T value) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            _memory_id = _get_new_memory_id();
-            _ref_count[_memory_id] = 1;
-            _is_deleted[_memory_id] = false;
+#if SAFE_PTR_LARGE_ALLOC_BOOL
+    // Maps anonymous memory for large allocations. The mapping is aligned to
+    // a huge page, so the kernel can back it with transparent huge pages
+    // from its first byte, and it is optionally prefaulted and locked.
+    inline void* _map_large_storage(const size_t bytes, const size_t alignment) {
+        const size_t length = _get_mapping_length(bytes);
+        const size_t align = std::max<size_t>(
+            alignment, SAFE_PTR_HUGE_PAGE_SIZE
+        );
+        if (length > std::numeric_limits<size_t>::max() - align) {
+            throw std::bad_array_new_length();
+        }
+        void* const mapping = mmap(
+            nullptr, length + align, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+        );
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        // unmap what is left before and after the aligned range
+        char* const first = static_cast<char*>(mapping);
+        char* const storage = reinterpret_cast<char*>(
+            (reinterpret_cast<std::uintptr_t>(first) + align - 1)
+            & ~static_cast<std::uintptr_t>(align - 1)
+        );
+        if (storage != first) {
+            munmap(first, storage - first);
+        }
+        const size_t tail = (first + length + align) - (storage + length);
+        if (tail != 0) {
+            munmap(storage + length, tail);
+        }
+
+        #ifdef MADV_HUGEPAGE
+            madvise(storage, length, MADV_HUGEPAGE);
         #endif
-        _begin = new T[size];
-        _end = _begin + size;
-        fill(value);
-    }
 
-    // constructor
-    SafePtr(const std::initializer_list<T>& il) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            _memory_id = _get_new_memory_id();
-            _ref_count[_memory_id] = 1;
-            _is_deleted[_memory_id] = false;
+        // MAP_POPULATE is not used because it would fault the pages in
+        // before madvise(), i.e. as regular pages.
+        #ifdef SAFE_PTR_LARGE_ALLOC_POPULATE
+            bool is_populated = false;
+            #ifdef MADV_POPULATE_WRITE
+                is_populated =
+                    madvise(storage, length, MADV_POPULATE_WRITE) == 0;
+            #endif
+            if (!is_populated) {
+                const size_t page_size = _get_page_size();
+                for (size_t i = 0; i < length; i += page_size) {
+                    static_cast<volatile char*>(storage)[i] = 0;
+                }
+            }
         #endif
-        _begin = new T[il.size()];
-        _end = _begin + il.size();
-        std::copy(il.begin(), il.end(), this->_begin);
-    }
 
-    // constructor
-    template<
-        typename InputIt,
-        typename std::enable_if<
-            !std::is_integral<InputIt>::value, int
-        >::type = 0
-    >
-    SafePtr(InputIt first, InputIt last) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            _memory_id = _get_new_memory_id();
-            _ref_count[_memory_id] = 1;
-            _is_deleted[_memory_id] = false;
+        #ifdef SAFE_PTR_LARGE_ALLOC_MLOCK
+            if (mlock(storage, length) != 0) {
+                const int error = errno;
+                munmap(storage, length);
+                throw std::system_error(
+                    error, std::generic_category(),
+                    "failed to lock the memory of a SafePtr"
+                );
+            }
         #endif
-        _construct_from_range(first, last, _sp_has_subtraction<InputIt>{});
+
+        return storage;
     }
 
-    // destructor
-    ~SafePtr() noexcept(!SAFE_PTR_TEST_BOOL) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            if (_get_is_view()) {
-                return;
+    inline void _unmap_large_storage(void* const storage, const size_t bytes) {
+        munmap(storage, _get_mapping_length(bytes));
+    }
+#endif
+
+#if SAFE_PTR_POSIX_BOOL
+    // How SafePtr::map_file() maps a file:
+    // - read_only: the memory must not be written to;
+    // - read_write: writes are carried to the file;
+    // - copy_on_write: writes are only seen by this process, and the pages
+    //   that are written to are copied.
+    enum class MapMode { read_only, read_write, copy_on_write };
+
+    // Maps the whole file at `path` and returns the address of its first
+    // byte, which is page aligned. `bytes` is set to the size of the file.
+    // `prefix_bytes` (at most a page) of anonymous memory are mapped right
+    // before it, e.g. for a header. The mapping is released by
+    // MmapAllocator::deallocate().
+    inline void* _map_file_storage(
+        const char* const path, const MapMode mode, const size_t prefix_bytes,
+        const size_t element_size, const size_t alignment, size_t& bytes
+    ) {
+        const size_t page_size = _get_page_size();
+        if (alignment > page_size) {
+            throw std::invalid_argument(
+                "it was tried to map a file with an alignment bigger than "
+                "the page size"
+            );
+        }
+        const int fd = open(
+            path, mode == MapMode::read_write ? O_RDWR : O_RDONLY
+        );
+        if (fd == -1) {
+            throw std::system_error(
+                errno, std::generic_category(), "failed to open the file"
+            );
+        }
+
+        char* storage = nullptr;
+        try {
+            struct stat file_status;
+            if (fstat(fd, &file_status) != 0) {
+                throw std::system_error(
+                    errno, std::generic_category(),
+                    "failed to get the size of the file"
+                );
             }
-            --_get_ref_count();
-            if (_get_ref_count() == 0) {
-                if(!_get_is_deleted()) {
-                    SAFE_PTR_WARNING("Memory was leaked.");
-                }
-                _ref_count.erase(_memory_id);
-                _is_deleted.erase(_memory_id);
+            bytes = static_cast<size_t>(file_status.st_size);
+            if (bytes % element_size != 0) {
+                throw std::invalid_argument(
+                    "it was tried to map a file whose size is not a multiple "
+                    "of the element size"
+                );
             }
-        #endif
+
+            // The file is mapped over anonymous memory reserved for it and
+            // the prefix, so both are released by a single munmap().
+            const size_t prefix = prefix_bytes == 0 ? 0 : page_size;
+            const size_t length = _get_mapping_length(bytes);
+            const size_t reserved = prefix + length == 0 ? page_size :
+                prefix + length;
+            void* const reservation = mmap(
+                nullptr, reserved, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+            );
+            if (reservation == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            storage = static_cast<char*>(reservation) + prefix;
+            if (length != 0 && mmap(
+                storage, length,
+                mode == MapMode::read_only ? PROT_READ : PROT_READ|PROT_WRITE,
+                (mode == MapMode::read_write ? MAP_SHARED : MAP_PRIVATE)
+                    | MAP_FIXED,
+                fd, 0
+            ) == MAP_FAILED) {
+                const int error = errno;
+                munmap(reservation, reserved);
+                throw std::system_error(
+                    error, std::generic_category(), "failed to map the file"
+                );
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd); // the mapping keeps the file open
+        return storage;
     }
+#endif
 
-    // copy constructor
-    SafePtr(const SafePtr& other) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            other._check_for_use_after_free();
-            this->_memory_id = _get_new_memory_id();
-            _ref_count[this->_memory_id] = 1;
-            _is_deleted[this->_memory_id] = false;
-        #endif
-        this->_begin = new T[other.size()];
-        this->_end = this->_begin + other.size();
-        std::copy(other.begin(), other.end(), this->_begin);
+#if SAFE_PTR_POSIX_BOOL
+    // Written by SafePtr::save() right before the elements. The fields have
+    // fixed sizes and no padding between them, so the header has the same
+    // layout everywhere except for the byte order, which it records.
+    struct _SerialHeader {
+        char magic[4];              // "FZSP"
+        std::uint8_t version;
+        std::uint8_t byte_order;    // 1 for little endian, 2 for big endian
+        std::uint16_t reserved0;
+        std::uint32_t element_size;
+        std::uint32_t reserved1;
+        std::uint64_t count;
+        std::uint64_t checksum;     // of the bytes of the elements
+    };
+    static_assert(sizeof(_SerialHeader) == 32, "unexpected header padding");
+
+    constexpr std::uint8_t _SERIAL_VERSION = 1;
+
+    #ifdef IOV_MAX
+        constexpr size_t _IOV_BATCH = IOV_MAX;
+    #else
+        constexpr size_t _IOV_BATCH = 16; // the minimum POSIX allows
+    #endif
+
+    inline std::uint8_t _get_byte_order() {
+        const std::uint16_t one = 1;
+        unsigned char first_byte;
+        std::memcpy(&first_byte, &one, 1);
+        return first_byte == 1 ? 1 : 2;
     }
-    
-    // move constructor
-    SafePtr(SafePtr&& other) noexcept(!SAFE_PTR_TEST_BOOL) {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            other._check_for_use_after_free();
-            this->_memory_id = other._memory_id;
-            if (!_get_is_view()) {
-                ++_get_ref_count();
+
+    inline std::uint64_t _rotate_left(const std::uint64_t x, const int bits) {
+        return (x << bits) | (x >> (64 - bits));
+    }
+
+    // 64-bit checksum of `bytes` bytes. The data is read 32 bytes at a time
+    // into four independent lanes, so checking a loaded SafePtr is about as
+    // fast as reading its memory.
+    inline std::uint64_t _get_checksum(const void* const data, const size_t bytes) {
+        constexpr std::uint64_t prime0 = 0x9e3779b185ebca87ULL;
+        constexpr std::uint64_t prime1 = 0xc2b2ae3d27d4eb4fULL;
+        const unsigned char* const bytes_ = static_cast<const unsigned char*>(
+            data
+        );
+        std::uint64_t lanes[4] = {prime0, prime1, 0, ~prime0};
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32) {
+            for (int lane = 0; lane != 4; ++lane) {
+                std::uint64_t word;
+                std::memcpy(&word, bytes_ + i + 8*lane, 8);
+                lanes[lane] = _rotate_left(lanes[lane] + word*prime1, 31)
+                    * prime0;
             }
-        #endif
-        this->_begin = other._begin;
-        this->_end = other._end;
+        }
+        std::uint64_t checksum = _rotate_left(lanes[0], 1)
+            + _rotate_left(lanes[1], 7) + _rotate_left(lanes[2], 12)
+            + _rotate_left(lanes[3], 18) + bytes;
+        for (; i != bytes; ++i) {
+            checksum = _rotate_left(checksum ^ (bytes_[i] * prime0), 11)
+                * prime1;
+        }
+        checksum ^= checksum >> 33;
+        checksum *= prime1;
+        checksum ^= checksum >> 29;
+        return checksum;
     }
 
-    // copy assignment operator
-    SafePtr& operator=(const SafePtr& other) {
-        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
-            if (this != &other) {
-        #endif
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            other._check_for_use_after_free();
-            if (!_get_is_view()) {
-                --_get_ref_count();
-                if (_get_ref_count()==0 && !_get_is_deleted()) {
-                    SAFE_PTR_WARNING("Memory was leaked.");
+    inline _SerialHeader _make_serial_header(
+        const size_t element_size, const size_t count, const void* const data
+    ) {
+        _SerialHeader header;
+        std::memcpy(header.magic, "FZSP", 4);
+        header.version = _SERIAL_VERSION;
+        header.byte_order = _get_byte_order();
+        header.reserved0 = 0;
+        header.element_size = static_cast<std::uint32_t>(element_size);
+        header.reserved1 = 0;
+        header.count = count;
+        header.checksum = _get_checksum(data, count * element_size);
+        return header;
+    }
+
+    // Throws if `header` is not the header of saved elements of
+    // `element_size` bytes.
+    inline void _check_serial_header(
+        const _SerialHeader& header, const size_t element_size
+    ) {
+        if (std::memcmp(header.magic, "FZSP", 4) != 0 ||
+            header.version != _SERIAL_VERSION
+        ) {
+            throw std::invalid_argument(
+                "it was tried to load a SafePtr from data that was not "
+                "written by SafePtr::save()"
+            );
+        }
+        if (header.byte_order != _get_byte_order()) {
+            throw std::invalid_argument(
+                "it was tried to load a SafePtr that was saved with another "
+                "byte order"
+            );
+        }
+        if (header.element_size != element_size) {
+            throw std::invalid_argument(
+                "it was tried to load a SafePtr that was saved with another "
+                "element size"
+            );
+        }
+    }
+
+    inline void _check_serial_checksum(
+        const _SerialHeader& header, const void* const data
+    ) {
+        if (_get_checksum(data, header.count * header.element_size)
+            != header.checksum
+        ) {
+            throw std::invalid_argument(
+                "the checksum of a loaded SafePtr does not match, so the data "
+                "was corrupted"
+            );
+        }
+    }
+
+    // Drops the first `bytes` bytes of the `count` buffers at `buffers`, and
+    // the empty buffers after them.
+    inline void _skip_buffers(
+        iovec*& buffers, size_t& count, size_t bytes
+    ) {
+        while (count != 0 && bytes >= buffers->iov_len) {
+            bytes -= buffers->iov_len;
+            ++buffers;
+            --count;
+        }
+        if (count != 0) {
+            buffers->iov_base = static_cast<char*>(buffers->iov_base) + bytes;
+            buffers->iov_len -= bytes;
+        }
+    }
+
+    // Writes the `count` buffers at `buffers` with as few writev() calls as
+    // possible, continuing after partial writes and interrupts, so it also
+    // works for pipes and sockets. The buffers are modified.
+    inline void _write_buffers(const int fd, iovec* buffers, size_t count) {
+        _skip_buffers(buffers, count, 0);
+        while (count != 0) {
+            const ssize_t written = writev(
+                fd, buffers, static_cast<int>(std::min(count, _IOV_BATCH))
+            );
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
                 }
+                throw std::system_error(
+                    errno, std::generic_category(),
+                    "failed to write to a file descriptor"
+                );
             }
-            this->_memory_id = _get_new_memory_id();
-            _ref_count[this->_memory_id] = 1;
-            _is_deleted[this->_memory_id] = false;
-        #endif
-        this->_begin = new T[other.size()];
-        this->_end = this->_begin + other.size();
-        std::copy(other.begin(), other.end(), this->_begin);
-        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
+            _skip_buffers(buffers, count, static_cast<size_t>(written));
+        }
+    }
+
+    // Like _write_buffers(), but reads them with readv().
+    inline void _read_buffers(const int fd, iovec* buffers, size_t count) {
+        _skip_buffers(buffers, count, 0);
+        while (count != 0) {
+            const ssize_t read = readv(
+                fd, buffers, static_cast<int>(std::min(count, _IOV_BATCH))
+            );
+            if (read < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(
+                    errno, std::generic_category(),
+                    "failed to read from a file descriptor"
+                );
             }
-        #endif
-        return *this;
+            if (read == 0) {
+                throw std::invalid_argument(
+                    "it was tried to load a SafePtr from data that ends "
+                    "before its last element"
+                );
+            }
+            _skip_buffers(buffers, count, static_cast<size_t>(read));
+        }
     }
 
-    // move assignment operator
-    SafePtr& operator=(SafePtr&& other) noexcept(!SAFE_PTR_TEST_BOOL) {
-        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
-            if (this != &other) {
-        #endif
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            other._check_for_use_after_free();
-            if (!_get_is_view()) {
-                --_get_ref_count();
-                if (_get_ref_count()==0 && !_get_is_deleted()) {
-                    SAFE_PTR_WARNING("Memory was leaked.");
+    inline int _open_file(const char* const path, const int flags) {
+        const int fd = open(path, flags, 0666);
+        if (fd == -1) {
+            throw std::system_error(
+                errno, std::generic_category(), "failed to open the file"
+            );
+        }
+        return fd;
+    }
+#endif
+
+    // How SafePtr::print() lays out the elements:
+    // - lines: one element per line, after its index;
+    // - compact: all elements in one line, between braces;
+    // - csv: all elements in one line, separated by commas, without the
+    //   label and the braces.
+    enum class PrintLayout { lines, compact, csv };
+
+    // What SafePtr::print() prints. When more than `head` + `tail` + 1
+    // elements would be printed, only the first `head` and the last `tail`
+    // ones are, with "..." between them.
+    struct PrintFormat {
+        PrintLayout layout;
+        size_t head;
+        size_t tail;
+
+        PrintFormat(
+            const PrintLayout layout = PrintLayout::lines,
+            const size_t head = 13,
+            const size_t tail = 12
+        ) : layout(layout), head(head), tail(tail) {}
+
+        // Prints every element.
+        static PrintFormat all(const PrintLayout layout = PrintLayout::lines) {
+            return PrintFormat(
+                layout, std::numeric_limits<size_t>::max(),
+                std::numeric_limits<size_t>::max()
+            );
+        }
+    };
+
+    // Appends the text of `value` to `text`, the same as `std::ostream <<`
+    // with the default flags would write, but without a stream for
+    // arithmetic types. `stream` is only used for the other types.
+    inline void _append_unsigned(std::string& text, unsigned long long value) {
+        static const char digit_pairs[] =
+            "0001020304050607080910111213141516171819"
+            "2021222324252627282930313233343536373839"
+            "4041424344454647484950515253545556575859"
+            "6061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        char digits[20];
+        char* first = digits + 20;
+        while (value >= 100) {
+            const size_t pair = static_cast<size_t>(value % 100) * 2;
+            value /= 100;
+            *--first = digit_pairs[pair + 1];
+            *--first = digit_pairs[pair];
+        }
+        if (value >= 10) {
+            *--first = digit_pairs[value*2 + 1];
+            *--first = digit_pairs[value*2];
+        } else {
+            *--first = static_cast<char>('0' + value);
+        }
+        text.append(first, digits + 20);
+    }
+
+    template<typename T>
+    typename std::enable_if<
+        std::is_integral<T>::value && std::is_unsigned<T>::value
+    >::type
+    _append_value(std::string& text, const T value, std::ostringstream&) {
+        _append_unsigned(text, value);
+    }
+
+    template<typename T>
+    typename std::enable_if<
+        std::is_integral<T>::value && std::is_signed<T>::value
+    >::type
+    _append_value(std::string& text, const T value, std::ostringstream&) {
+        if (value < 0) {
+            text += '-';
+            _append_unsigned(
+                text, 0ULL - static_cast<unsigned long long>(value)
+            );
+        } else {
+            _append_unsigned(text, static_cast<unsigned long long>(value));
+        }
+    }
+
+    inline void _append_value(
+        std::string& text, const bool value, std::ostringstream&
+    ) {
+        text += value ? '1' : '0';
+    }
+
+    inline void _append_value(
+        std::string& text, const char value, std::ostringstream&
+    ) {
+        text += value;
+    }
+
+    inline void _append_value(
+        std::string& text, const signed char value, std::ostringstream&
+    ) {
+        text += static_cast<char>(value);
+    }
+
+    inline void _append_value(
+        std::string& text, const unsigned char value, std::ostringstream&
+    ) {
+        text += static_cast<char>(value);
+    }
+
+    // Appends `value` as printf("%g") would, i.e. with 6 significant digits.
+    // It is scaled to 6 digits before the point with one multiplication or
+    // division by an exact power of 10, which is correctly rounded, and the
+    // rounding to an integer is only trusted far from ties. snprintf() is
+    // used otherwise, and for zeros, infinities, NaNs and extreme exponents.
+    inline void _append_floating(std::string& text, const double value) {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        const double magnitude = std::fabs(value);
+        bool is_scaled = false;
+        int exponent = 0;
+        double scaled = 0;
+        if (magnitude >= 1e-300 && magnitude <= 1e300) {
+            exponent = static_cast<int>(std::floor(std::log10(magnitude)));
+            // log10() may be off by one next to powers of 10
+            for (int attempt = 0; attempt != 3 && !is_scaled; ++attempt) {
+                const int shift = 5 - exponent;
+                if (shift > 22 || shift < -22) {
+                    break;
+                }
+                scaled = shift >= 0 ? magnitude * powers[shift] :
+                    magnitude / powers[-shift];
+                if (scaled >= 1e6) {
+                    ++exponent;
+                } else if (scaled < 1e5) {
+                    --exponent;
+                } else {
+                    is_scaled = true;
                 }
             }
-            this->_memory_id = other._memory_id;
-            if (!_get_is_view()) {
-                ++_get_ref_count();
+        }
+        const double integer = std::floor(scaled);
+        if (!is_scaled || std::fabs(scaled - integer - 0.5) < 1e-6) {
+            char digits[32];
+            const int length = std::snprintf(
+                digits, sizeof(digits), "%g", value
+            );
+            text.append(digits, static_cast<size_t>(length));
+            return;
+        }
+
+        unsigned long mantissa = static_cast<unsigned long>(integer)
+            + (scaled - integer > 0.5 ? 1 : 0);
+        if (mantissa == 1000000) {
+            mantissa = 100000;
+            ++exponent;
+        }
+        char digits[6];
+        for (int i = 5; i >= 0; --i) {
+            digits[i] = static_cast<char>('0' + mantissa % 10);
+            mantissa /= 10;
+        }
+        int significant = 6;
+        while (digits[significant - 1] == '0') {
+            --significant;
+        }
+
+        char buffer[32];
+        char* last = buffer;
+        if (value < 0) {
+            *last++ = '-';
+        }
+        const bool is_fixed = exponent >= -4 && exponent < 6;
+        const int integer_digits = is_fixed ? std::max(exponent + 1, 0) : 1;
+        if (integer_digits == 0) {
+            *last++ = '0';
+        }
+        for (int i = 0; i != integer_digits; ++i) {
+            *last++ = digits[i];
+        }
+        if (significant > integer_digits) {
+            *last++ = '.';
+            for (int i = exponent + 1; i < 0 && is_fixed; ++i) {
+                *last++ = '0';
             }
-        #endif
-        this->_begin = other._begin;
-        this->_end = other._end;
-        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
+            for (int i = integer_digits; i != significant; ++i) {
+                *last++ = digits[i];
             }
-        #endif
-        return *this;
+        }
+        if (!is_fixed) {
+            *last++ = 'e';
+            *last++ = exponent < 0 ? '-' : '+';
+            const int exponent_magnitude = std::abs(exponent);
+            if (exponent_magnitude >= 100) {
+                *last++ = static_cast<char>('0' + exponent_magnitude / 100);
+            }
+            *last++ = static_cast<char>('0' + exponent_magnitude / 10 % 10);
+            *last++ = static_cast<char>('0' + exponent_magnitude % 10);
+        }
+        text.append(buffer, last);
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    _append_value(std::string& text, const T value, std::ostringstream&) {
+        if (std::is_same<T, long double>::value) {
+            char digits[64];
+            const int length = std::snprintf(
+                digits, sizeof(digits), "%Lg", static_cast<long double>(value)
+            );
+            text.append(digits, static_cast<size_t>(length));
+        } else {
+            _append_floating(text, static_cast<double>(value));
+        }
+    }
+
+    template<typename T>
+    typename std::enable_if<!std::is_arithmetic<T>::value>::type
+    _append_value(
+        std::string& text, const T& value, std::ostringstream& stream
+    ) {
+        stream.str(std::string());
+        stream << value;
+        text += stream.str();
+    }
+
+    // Held while a SafePtr is printed, so prints from different threads
+    // do not interleave.
+    inline std::mutex& _get_print_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+// Bulk fill and copy kernels
+//
+// They are used for trivially copyable types, whose elements can be written
+// as raw bytes. On x86 with GCC or Clang, the widest SIMD instructions the
+// CPU supports (AVX-512, AVX2 or SSE2) are picked at runtime. Buffers of at
+// least SAFE_PTR_STREAMING_THRESHOLD bytes are written with non-temporal
+// stores, which bypass the cache, so writing them does not evict data that
+// is still needed. Defining SAFE_PTR_DISABLE_SIMD leaves only memset() and
+// memcpy().
+
+#if SAFE_PTR_SIMD_BOOL
+    // The _repeat_* kernels copy the `period` bytes at `first` over the
+    // rest of [first, last), whose size is a multiple of `period`. The
+    // period is a multiple of the vector size, of at most
+    // _MAX_REPEAT_VECTORS vectors. The _stream_copy_* kernels copy from
+    // `source` to [first, last) with non-temporal stores. `first` and `last`
+    // are aligned to the vector size.
+
+    constexpr size_t _MAX_REPEAT_VECTORS = 8;
+
+    __attribute__((target("avx512f")))
+    inline void _repeat_avx512(
+        char* const first, char* const last, const size_t period,
+        const bool stream
+    ) {
+        const __m512i* const source = reinterpret_cast<const __m512i*>(first);
+        __m512i blocks[_MAX_REPEAT_VECTORS];
+        const size_t count = period / 64;
+        for (size_t i = 0; i != count; ++i) {
+            blocks[i] = _mm512_load_si512(source + i);
+        }
+        __m512i* it = reinterpret_cast<__m512i*>(first + period);
+        __m512i* const end = reinterpret_cast<__m512i*>(last);
+        if (count == 1 && stream) {
+            for (; it != end; ++it) {
+                _mm512_stream_si512(it, blocks[0]);
+            }
+        } else if (count == 1) {
+            for (; it != end; ++it) {
+                _mm512_store_si512(it, blocks[0]);
+            }
+        } else if (stream) {
+            while (it != end) {
+                for (size_t i = 0; i != count; ++i, ++it) {
+                    _mm512_stream_si512(it, blocks[i]);
+                }
+            }
+        } else {
+            while (it != end) {
+                for (size_t i = 0; i != count; ++i, ++it) {
+                    _mm512_store_si512(it, blocks[i]);
+                }
+            }
+        }
+        if (stream) {
+            _mm_sfence();
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    inline void _stream_copy_avx512(
+        char* first, char* const last, const char* source
+    ) {
+        for (; first != last; first += 64, source += 64) {
+            _mm512_stream_si512(
+                reinterpret_cast<__m512i*>(first), _mm512_loadu_si512(source)
+            );
+        }
+        _mm_sfence();
+    }
+
+    __attribute__((target("avx2")))
+    inline void _repeat_avx2(
+        char* const first, char* const last, const size_t period,
+        const bool stream
+    ) {
+        const __m256i* const source = reinterpret_cast<const __m256i*>(first);
+        __m256i blocks[_MAX_REPEAT_VECTORS];
+        const size_t count = period / 32;
+        for (size_t i = 0; i != count; ++i) {
+            blocks[i] = _mm256_load_si256(source + i);
+        }
+        __m256i* it = reinterpret_cast<__m256i*>(first + period);
+        __m256i* const end = reinterpret_cast<__m256i*>(last);
+        if (count == 1 && stream) {
+            for (; it != end; ++it) {
+                _mm256_stream_si256(it, blocks[0]);
+            }
+        } else if (count == 1) {
+            for (; it != end; ++it) {
+                _mm256_store_si256(it, blocks[0]);
+            }
+        } else if (stream) {
+            while (it != end) {
+                for (size_t i = 0; i != count; ++i, ++it) {
+                    _mm256_stream_si256(it, blocks[i]);
+                }
+            }
+        } else {
+            while (it != end) {
+                for (size_t i = 0; i != count; ++i, ++it) {
+                    _mm256_store_si256(it, blocks[i]);
+                }
+            }
+        }
+        if (stream) {
+            _mm_sfence();
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline void _stream_copy_avx2(
+        char* first, char* const last, const char* source
+    ) {
+        for (; first != last; first += 32, source += 32) {
+            _mm256_stream_si256(
+                reinterpret_cast<__m256i*>(first),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source))
+            );
+        }
+        _mm_sfence();
+    }
+
+    __attribute__((target("sse2")))
+    inline void _repeat_sse2(
+        char* const first, char* const last, const size_t period,
+        const bool stream
+    ) {
+        const __m128i* const source = reinterpret_cast<const __m128i*>(first);
+        __m128i blocks[_MAX_REPEAT_VECTORS];
+        const size_t count = period / 16;
+        for (size_t i = 0; i != count; ++i) {
+            blocks[i] = _mm_load_si128(source + i);
+        }
+        __m128i* it = reinterpret_cast<__m128i*>(first + period);
+        __m128i* const end = reinterpret_cast<__m128i*>(last);
+        if (count == 1 && stream) {
+            for (; it != end; ++it) {
+                _mm_stream_si128(it, blocks[0]);
+            }
+        } else if (count == 1) {
+            for (; it != end; ++it) {
+                _mm_store_si128(it, blocks[0]);
+            }
+        } else if (stream) {
+            while (it != end) {
+                for (size_t i = 0; i != count; ++i, ++it) {
+                    _mm_stream_si128(it, blocks[i]);
+                }
+            }
+        } else {
+            while (it != end) {
+                for (size_t i = 0; i != count; ++i, ++it) {
+                    _mm_store_si128(it, blocks[i]);
+                }
+            }
+        }
+        if (stream) {
+            _mm_sfence();
+        }
+    }
+
+    __attribute__((target("sse2")))
+    inline void _stream_copy_sse2(
+        char* first, char* const last, const char* source
+    ) {
+        for (; first != last; first += 16, source += 16) {
+            _mm_stream_si128(
+                reinterpret_cast<__m128i*>(first),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(source))
+            );
+        }
+        _mm_sfence();
+    }
+
+    struct _Kernels {
+        size_t width; // 0 if the CPU has none of the instructions above
+        void (*repeat)(char*, char*, size_t, bool);
+        void (*stream_copy)(char*, char*, const char*);
+    };
+
+    inline const _Kernels& _get_kernels() {
+        static const _Kernels kernels = [](){
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return _Kernels{64, &_repeat_avx512, &_stream_copy_avx512};
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return _Kernels{32, &_repeat_avx2, &_stream_copy_avx2};
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return _Kernels{16, &_repeat_sse2, &_stream_copy_sse2};
+            }
+            return _Kernels{0, nullptr, nullptr};
+        }();
+        return kernels;
+    }
+#endif
+
+// Fills `bytes` bytes at `first` with copies of the `size` bytes at `value`,
+// by copying what was already written, so it takes log(count) memcpy()s.
+inline void _fill_by_doubling(
+    char* const first, const size_t bytes, const void* const value,
+    const size_t size
+) {
+    std::memcpy(first, value, size);
+    for (size_t done = size; done < bytes; ) {
+        const size_t count = std::min(done, bytes - done);
+        std::memcpy(first + done, first, count);
+        done += count;
+    }
+}
+
+// Writes `count` copies of the `size` bytes at `value` to `data`. `value`
+// must not point into the memory written to.
+inline void _fill_bytes(
+    void* const data, const void* const value, const size_t size,
+    const size_t count
+) {
+    if (count == 0) {
+        return;
+    }
+    char* const first = static_cast<char*>(data);
+    const size_t bytes = size * count;
+    const unsigned char* const value_bytes =
+        static_cast<const unsigned char*>(value);
+    const bool is_byte_pattern = std::all_of(
+        value_bytes + 1, value_bytes + size,
+        [value_bytes](const unsigned char b) { return b == value_bytes[0]; }
+    );
+    const bool stream = bytes >= SAFE_PTR_STREAMING_THRESHOLD;
+    if (is_byte_pattern && !stream) {
+        std::memset(first, value_bytes[0], bytes);
+        return;
+    }
+
+    #if SAFE_PTR_SIMD_BOOL
+        // The bytes repeat every `period` bytes, the least common multiple
+        // of the value size and the vector size, so the first period after
+        // an aligned address can be repeated by whole vectors.
+        const _Kernels& kernels = _get_kernels();
+        const size_t width = kernels.width;
+        size_t gcd = width;
+        for (size_t b = size; b != 0; ) {
+            const size_t r = gcd % b;
+            gcd = b;
+            b = r;
+        }
+        const size_t period = width == 0 ? 0 : size / gcd * width;
+        if (
+            width != 0 && period <= _MAX_REPEAT_VECTORS * width &&
+            bytes >= 3 * period + width
+        ) {
+            char* const last = first + bytes;
+            char* const aligned_first = reinterpret_cast<char*>(
+                (reinterpret_cast<std::uintptr_t>(first) + width - 1)
+                & ~static_cast<std::uintptr_t>(width - 1)
+            );
+            char* const aligned_last =
+                aligned_first + (last - aligned_first) / period * period;
+            const size_t head = aligned_first - first + period;
+            _fill_by_doubling(
+                first, (head + size - 1) / size * size, value, size
+            );
+            kernels.repeat(aligned_first, aligned_last, period, stream);
+            std::memcpy(
+                aligned_last, aligned_last - period, last - aligned_last
+            );
+            return;
+        }
+    #endif
+
+    if (is_byte_pattern) {
+        std::memset(first, value_bytes[0], bytes);
+    } else {
+        _fill_by_doubling(first, bytes, value, size);
+    }
+}
+
+// Copies `bytes` bytes from `source` to `data`. The ranges must not overlap.
+inline void _copy_bytes(
+    void* const data, const void* const source, const size_t bytes
+) {
+    #if SAFE_PTR_SIMD_BOOL
+        const _Kernels& kernels = _get_kernels();
+        const size_t width = kernels.width;
+        if (width != 0 && bytes >= SAFE_PTR_STREAMING_THRESHOLD) {
+            char* const first = static_cast<char*>(data);
+            char* const last = first + bytes;
+            const char* const from = static_cast<const char*>(source);
+            char* const aligned_first = reinterpret_cast<char*>(
+                (reinterpret_cast<std::uintptr_t>(first) + width - 1)
+                & ~static_cast<std::uintptr_t>(width - 1)
+            );
+            char* const aligned_last = reinterpret_cast<char*>(
+                reinterpret_cast<std::uintptr_t>(last)
+                & ~static_cast<std::uintptr_t>(width - 1)
+            );
+            if (aligned_first < aligned_last) {
+                const size_t head = aligned_first - first;
+                std::memcpy(first, from, head);
+                kernels.stream_copy(aligned_first, aligned_last, from + head);
+                std::memcpy(
+                    aligned_last, from + (aligned_last - first),
+                    last - aligned_last
+                );
+                return;
+            }
+        }
+    #endif
+    if (bytes != 0) {
+        std::memcpy(data, source, bytes);
+    }
+}
+
+// Spreads the construction or fill() of a SafePtr over several threads. On
+// NUMA systems, a page is placed on the node of the thread that first writes
+// to it. The elements of range() `i` are written by a thread started for
+// them, after on_thread_start() was called there with `i`, so pinning that
+// thread to a CPU of some node places the range on that node, and a worker
+// later pinned to the same node reads memory local to it. interleaved()
+// instead hands the pages out to the threads in turn, which spreads the
+// buffer evenly over the nodes for memory that is accessed by every thread.
+class FirstTouch
+{
+public:
+    // `thread_count` 0 means std::thread::hardware_concurrency().
+    explicit FirstTouch(const size_t thread_count = 0)
+        : FirstTouch(thread_count, false) {}
+
+    static FirstTouch interleaved(const size_t thread_count = 0) {
+        return FirstTouch(thread_count, true);
+    }
+
+    size_t thread_count() const {
+        return _thread_count;
+    }
+
+    bool is_interleaved() const {
+        return _is_interleaved;
+    }
+
+    // Sets a function that is called with the index of each thread, from
+    // that thread, before it writes to any element, e.g. to pin the thread
+    // to a CPU. If a thread can not be started, its elements are written by
+    // the calling thread instead, without calling the function.
+    FirstTouch& on_thread_start(std::function<void(size_t)> hook) {
+        _on_thread_start = std::move(hook);
+        return *this;
+    }
+
+    // The elements [first, second) of `size` elements that the thread
+    // `index` initializes when the pages are not interleaved.
+    std::pair<size_t,size_t> range(const size_t index, const size_t size)
+    const {
+        return std::make_pair(
+            _get_boundary(index, size), _get_boundary(index + 1, size)
+        );
+    }
+
+private:
+    template<typename, size_t, typename>
+    friend class SafePtr;
+
+    size_t _thread_count;
+    bool _is_interleaved;
+    std::function<void(size_t)> _on_thread_start;
+
+    FirstTouch(const size_t thread_count, const bool is_interleaved)
+        : _thread_count(thread_count), _is_interleaved(is_interleaved)
+    {
+        if (_thread_count == 0) {
+            _thread_count = std::max<size_t>(
+                std::thread::hardware_concurrency(), 1
+            );
+        }
+    }
+
+    // computed like this so the last range ends exactly at `size`, without
+    // overflowing for big sizes
+    size_t _get_boundary(const size_t index, const size_t size) const {
+        return size / _thread_count * index +
+            size % _thread_count * index / _thread_count;
+    }
+
+    // Calls `f(first, last)` for every range of elements that the thread
+    // `index` initializes, out of `size` elements of `element_size` bytes
+    // starting at `data`. Interleaved ranges end at page boundaries.
+    template<typename F>
+    void _for_each_chunk(
+        const size_t index, const void* const data, const size_t size,
+        const size_t element_size, F f
+    ) const {
+        if (!_is_interleaved) {
+            f(_get_boundary(index, size), _get_boundary(index + 1, size));
+            return;
+        }
+        #if SAFE_PTR_POSIX_BOOL
+            const size_t page_size = _get_page_size();
+        #else
+            const size_t page_size = 4096;
+        #endif
+        const size_t chunk_size = std::max<size_t>(
+            page_size / element_size, 1
+        );
+        // elements before `data` in its first page
+        const size_t offset = std::min(
+            reinterpret_cast<std::uintptr_t>(data) % page_size / element_size,
+            chunk_size - 1
+        );
+        for (size_t chunk = index; ; chunk += _thread_count) {
+            const size_t first = chunk == 0 ? 0 : chunk*chunk_size - offset;
+            if (first >= size) {
+                return;
+            }
+            f(first, std::min((chunk + 1) * chunk_size - offset, size));
+        }
+    }
+};
+
+// Allocators
+//
+// The third template parameter of SafePtr is a class that provides its
+// storage. A SafePtr has no room to keep an allocator object, so the
+// allocator is used only through static members:
+// - `static void* allocate(size_t bytes, size_t alignment)`: returns storage
+//   of `bytes` bytes aligned to `alignment`, or throws;
+// - `static void deallocate(void* storage, size_t bytes, size_t alignment)`:
+//   releases storage returned by allocate() with the same arguments;
+// - `static constexpr bool requires_free`: whether free() must be called for
+//   the storage to be released. If false, SAFE_PTR_DEBUG does not report
+//   memory that is never freed as leaked.
+// Optionally, for SafePtr::resize():
+// - `static void* reallocate(void* storage, size_t old_bytes,
+//   size_t new_bytes, size_t alignment)`: resizes storage returned by
+//   allocate() with `old_bytes` and `alignment`, keeping its first bytes,
+//   possibly moving it. Returns nullptr, with the storage left untouched, if
+//   it can not do better than allocating new storage and copying.
+
+// Allocates with ::operator new. Alignments that ::operator new does not
+// guarantee are obtained by allocating `alignment` extra bytes and keeping the
+// pointer to the whole block right before the aligned address. If
+// SAFE_PTR_LARGE_ALLOC_THRESHOLD is defined, storage of at least that many
+// bytes is mapped directly with mmap() instead.
+struct DefaultAllocator
+{
+    static constexpr bool requires_free = true;
+
+    static void* allocate(const size_t bytes, const size_t alignment) {
+        #if SAFE_PTR_LARGE_ALLOC_BOOL
+            if (_is_large(bytes)) {
+                return _map_large_storage(bytes, alignment);
+            }
+        #endif
+        if (alignment <= alignof(std::max_align_t)) {
+            return ::operator new(bytes);
+        }
+        const size_t extra_bytes = alignment - 1 + sizeof(void*);
+        if (bytes > std::numeric_limits<size_t>::max() - extra_bytes) {
+            throw std::bad_array_new_length();
+        }
+        void* const block = ::operator new(bytes + extra_bytes);
+        const std::uintptr_t address =
+            (reinterpret_cast<std::uintptr_t>(block) + extra_bytes)
+            & ~static_cast<std::uintptr_t>(alignment - 1);
+        std::memcpy(
+            reinterpret_cast<void*>(address - sizeof(void*)), &block,
+            sizeof(void*)
+        );
+        return reinterpret_cast<void*>(address);
+    }
+
+    static void deallocate(
+        void* const storage, const size_t bytes, const size_t alignment
+    ) {
+        #if SAFE_PTR_LARGE_ALLOC_BOOL
+            if (_is_large(bytes)) {
+                _unmap_large_storage(storage, bytes);
+                return;
+            }
+        #else
+            (void)bytes;
+        #endif
+        if (alignment <= alignof(std::max_align_t)) {
+            // GCC can not tell that storage after an inline header (see
+            // SAFE_PTR_DEBUG_INLINE_HEADER) never gets here on its own
+            #if defined(__GNUC__) && !defined(__clang__)
+                #pragma GCC diagnostic push
+                #pragma GCC diagnostic ignored "-Wfree-nonheap-object"
+            #endif
+            ::operator delete(storage);
+            #if defined(__GNUC__) && !defined(__clang__)
+                #pragma GCC diagnostic pop
+            #endif
+            return;
+        }
+        // The block pointer is read through its address, as indexing
+        // `storage` with -1 reads outside of what the compiler sees as the
+        // storage.
+        void* block;
+        std::memcpy(
+            &block,
+            reinterpret_cast<const void*>(
+                reinterpret_cast<std::uintptr_t>(storage) - sizeof(void*)
+            ),
+            sizeof(void*)
+        );
+        ::operator delete(block);
+    }
+
+    // Memory from ::operator new can not be resized in place, but large
+    // mappings are moved by the kernel with mremap() where available,
+    // without copying their pages.
+    static void* reallocate(
+        void* const storage, const size_t old_bytes, const size_t new_bytes,
+        const size_t alignment
+    ) {
+        #if SAFE_PTR_LARGE_ALLOC_BOOL && defined(MREMAP_MAYMOVE)
+            if (
+                _is_large(old_bytes) && _is_large(new_bytes) &&
+                alignment <= _get_page_size()
+            ) {
+                void* const resized = mremap(
+                    storage, _get_mapping_length(old_bytes),
+                    _get_mapping_length(new_bytes), MREMAP_MAYMOVE
+                );
+                if (resized != MAP_FAILED) {
+                    return resized;
+                }
+            }
+        #else
+            (void)storage;
+            (void)old_bytes;
+            (void)new_bytes;
+            (void)alignment;
+        #endif
+        return nullptr;
+    }
+
+private:
+    #if SAFE_PTR_LARGE_ALLOC_BOOL
+        static bool _is_large(const size_t bytes) {
+            return bytes != 0 && bytes >= (SAFE_PTR_LARGE_ALLOC_THRESHOLD);
+        }
+    #endif
+};
+
+// Bump pointer allocator for many short-lived allocations. Memory is taken
+// from blocks of `block_size` bytes (or bigger, for allocations that do not
+// fit) and is only released all at once by reset() or by the destructor. An
+// Arena must only be used by one thread at a time.
+class Arena
+{
+public:
+    explicit Arena(const size_t block_size = 1024 * 1024)
+        : _block_size(block_size), _blocks(nullptr),
+          _cursor(nullptr), _limit(nullptr)
+    {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        _release_blocks(nullptr);
+    }
+
+    void* allocate(const size_t bytes, const size_t alignment) {
+        char* storage = _align(_cursor, alignment);
+        if (
+            _cursor == nullptr ||
+            storage > _limit ||
+            bytes > static_cast<size_t>(_limit - storage)
+        ) {
+            _add_block(bytes, alignment);
+            storage = _align(_cursor, alignment);
+        }
+        _cursor = storage + bytes;
+        return storage;
+    }
+
+    // Releases everything that was allocated from the arena. The first block
+    // is kept to be reused.
+    void reset() {
+        if (_blocks == nullptr) {
+            return;
+        }
+        _Block* first = _blocks;
+        while (first->previous != nullptr) {
+            first = first->previous;
+        }
+        _release_blocks(first);
+        _blocks = first;
+        _cursor = reinterpret_cast<char*>(first + 1);
+        _limit = _cursor + first->size;
+    }
+
+    // Makes `arena` the one used by ArenaAllocator in the current thread,
+    // until the Scope is destroyed.
+    class Scope
+    {
+    public:
+        explicit Scope(Arena& arena) : _previous(_get_current()) {
+            _get_current() = &arena;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() {
+            _get_current() = _previous;
+        }
+
+    private:
+        Arena* _previous;
+    };
+
+    // Returns the arena of the innermost Scope of the current thread, or
+    // nullptr if there is none.
+    static Arena* current() {
+        return _get_current();
+    }
+
+private:
+    struct alignas(std::max_align_t) _Block {
+        _Block* previous;
+        size_t size; // usable bytes after the _Block itself
+    };
+
+    size_t _block_size;
+    _Block* _blocks; // most recent block
+    char* _cursor;
+    char* _limit;
+
+    static Arena*& _get_current() {
+        static thread_local Arena* current = nullptr;
+        return current;
+    }
+
+    static char* _align(char* const ptr, const size_t alignment) {
+        return reinterpret_cast<char*>(
+            (reinterpret_cast<std::uintptr_t>(ptr) + alignment - 1)
+            & ~static_cast<std::uintptr_t>(alignment - 1)
+        );
+    }
+
+    void _add_block(const size_t bytes, const size_t alignment) {
+        const size_t extra_bytes = sizeof(_Block) + alignment;
+        if (bytes > std::numeric_limits<size_t>::max() - extra_bytes) {
+            throw std::bad_array_new_length();
+        }
+        const size_t size = std::max(_block_size, bytes + alignment);
+        _Block* const block = static_cast<_Block*>(
+            ::operator new(sizeof(_Block) + size)
+        );
+        block->previous = _blocks;
+        block->size = size;
+        _blocks = block;
+        _cursor = reinterpret_cast<char*>(block + 1);
+        _limit = _cursor + size;
+    }
+
+    // Releases the blocks that were added after `keep`.
+    void _release_blocks(_Block* const keep) {
+        while (_blocks != keep) {
+            _Block* const previous = _blocks->previous;
+            ::operator delete(_blocks);
+            _blocks = previous;
+        }
+    }
+};
+
+// Allocates from the arena of the innermost Arena::Scope of the calling
+// thread. Deallocating does nothing: the memory is released with the arena,
+// so calling free() on a SafePtr that uses it is optional. free() still
+// destroys the elements.
+struct ArenaAllocator
+{
+    static constexpr bool requires_free = false;
+
+    static void* allocate(const size_t bytes, const size_t alignment) {
+        Arena* const arena = Arena::current();
+        if (arena == nullptr) {
+            throw std::logic_error(
+                "it was tried to allocate from an arena outside of an "
+                "Arena::Scope"
+            );
+        }
+        return arena->allocate(bytes, alignment);
+    }
+
+    static void deallocate(void* const, const size_t, const size_t) {}
+};
+
+// Serves small allocations from per thread free lists, one for each size
+// class (powers of 2 from 16 to 4096 bytes). Memory freed by the thread that
+// allocated it goes back to that thread's free list directly. Memory freed by
+// another thread is pushed to a lock free queue of the owner thread, which
+// takes it back the next time one of its free lists runs out. Larger or over
+// aligned allocations are forwarded to DefaultAllocator. Pooled memory is
+// kept for reuse and never returned to the system; when a thread exits, its
+// free lists are adopted by the next thread that starts allocating.
+class PoolAllocator
+{
+public:
+    static constexpr bool requires_free = true;
+
+    static void* allocate(const size_t bytes, const size_t alignment) {
+        if (!_is_pooled(bytes, alignment)) {
+            return DefaultAllocator::allocate(bytes, alignment);
+        }
+        return _get_cache().allocate(_get_size_class(bytes));
+    }
+
+    static void deallocate(
+        void* const storage, const size_t bytes, const size_t alignment
+    ) {
+        if (!_is_pooled(bytes, alignment)) {
+            DefaultAllocator::deallocate(storage, bytes, alignment);
+            return;
+        }
+        // The header is found through the address of the storage, as
+        // pointer arithmetic on `storage` would step out of what the
+        // compiler sees as the storage.
+        _Block* const block = reinterpret_cast<_Block*>(
+            reinterpret_cast<std::uintptr_t>(storage) - sizeof(_Block)
+        );
+        if (block->owner == _get_current_cache()) {
+            block->owner->push_local(block);
+        } else {
+            block->owner->push_returned(block);
+        }
+    }
+
+    // Storage stays where it is if the new size is in the same size class.
+    static void* reallocate(
+        void* const storage, const size_t old_bytes, const size_t new_bytes,
+        const size_t alignment
+    ) {
+        if (
+            _is_pooled(old_bytes, alignment) &&
+            _is_pooled(new_bytes, alignment) &&
+            _get_size_class(old_bytes) == _get_size_class(new_bytes)
+        ) {
+            return storage;
+        }
+        return nullptr;
+    }
+
+private:
+    static constexpr size_t _CLASS_COUNT = 9;
+    static constexpr size_t _MIN_CLASS_BYTES = 16;
+    static constexpr size_t _MAX_CLASS_BYTES =
+        _MIN_CLASS_BYTES << (_CLASS_COUNT - 1);
+    static constexpr size_t _CHUNK_BYTES = 64 * 1024;
+
+    struct _Cache;
+
+    // Placed right before the memory handed out. While a block is in a free
+    // list, the pointer to the next block is kept in that memory.
+    struct alignas(std::max_align_t) _Block {
+        _Cache* owner;
+        size_t size_class;
+
+        _Block*& next() {
+            return *reinterpret_cast<_Block**>(this + 1);
+        }
+    };
+
+    struct _Cache {
+        _Block* free_lists[_CLASS_COUNT];
+        std::atomic<_Block*> returned; // pushed by other threads
+        char* chunk_cursor;
+        char* chunk_limit;
+        _Cache* next_orphan;
+
+        _Cache()
+            : returned(nullptr), chunk_cursor(nullptr), chunk_limit(nullptr),
+              next_orphan(nullptr)
+        {
+            std::fill(free_lists, free_lists + _CLASS_COUNT, nullptr);
+        }
+
+        void* allocate(const size_t size_class) {
+            if (free_lists[size_class] == nullptr) {
+                take_returned();
+            }
+            _Block* block = free_lists[size_class];
+            if (block != nullptr) {
+                free_lists[size_class] = block->next();
+            } else {
+                block = carve(size_class);
+            }
+            return block + 1;
+        }
+
+        void push_local(_Block* const block) {
+            block->next() = free_lists[block->size_class];
+            free_lists[block->size_class] = block;
+        }
+
+        void push_returned(_Block* const block) {
+            _Block* head = returned.load(std::memory_order_relaxed);
+            do {
+                block->next() = head;
+            } while (!returned.compare_exchange_weak(
+                head, block, std::memory_order_release,
+                std::memory_order_relaxed
+            ));
+        }
+
+        // Only the owner thread takes from the queue, and it always takes
+        // the whole queue at once, so the pushes above are free of ABA.
+        void take_returned() {
+            _Block* block = returned.exchange(
+                nullptr, std::memory_order_acquire
+            );
+            while (block != nullptr) {
+                _Block* const next = block->next();
+                push_local(block);
+                block = next;
+            }
+        }
+
+        _Block* carve(const size_t size_class) {
+            const size_t block_bytes =
+                sizeof(_Block) + (_MIN_CLASS_BYTES << size_class);
+            if (
+                chunk_cursor == nullptr ||
+                static_cast<size_t>(chunk_limit - chunk_cursor) < block_bytes
+            ) {
+                chunk_cursor = static_cast<char*>(
+                    ::operator new(_CHUNK_BYTES)
+                );
+                chunk_limit = chunk_cursor + _CHUNK_BYTES;
+            }
+            _Block* const block = reinterpret_cast<_Block*>(chunk_cursor);
+            chunk_cursor += block_bytes;
+            block->owner = this;
+            block->size_class = size_class;
+            return block;
+        }
+    };
+
+    // Gives the cache of a thread back to the orphan list when it exits.
+    struct _CacheOwner {
+        _Cache* cache;
+
+        _CacheOwner() {
+            {
+                std::lock_guard<std::mutex> lock(_get_orphans_mutex());
+                cache = _get_orphans();
+                if (cache != nullptr) {
+                    _get_orphans() = cache->next_orphan;
+                }
+            }
+            if (cache == nullptr) {
+                cache = new _Cache;
+            }
+            _get_current_cache() = cache;
+        }
+
+        ~_CacheOwner() {
+            _get_current_cache() = nullptr;
+            std::lock_guard<std::mutex> lock(_get_orphans_mutex());
+            cache->next_orphan = _get_orphans();
+            _get_orphans() = cache;
+        }
+    };
+
+    static bool _is_pooled(const size_t bytes, const size_t alignment) {
+        return bytes <= _MAX_CLASS_BYTES &&
+            alignment <= alignof(std::max_align_t);
+    }
+
+    static size_t _get_size_class(const size_t bytes) {
+        size_t size_class = 0;
+        while ((_MIN_CLASS_BYTES << size_class) < bytes) {
+            ++size_class;
+        }
+        return size_class;
+    }
+
+    static _Cache& _get_cache() {
+        static thread_local _CacheOwner owner;
+        return *owner.cache;
+    }
+
+    // Unlike _get_cache(), never creates the cache, and returns nullptr
+    // once the thread has started exiting.
+    static _Cache*& _get_current_cache() {
+        static thread_local _Cache* current = nullptr;
+        return current;
+    }
+
+    static _Cache*& _get_orphans() {
+        static _Cache* orphans = nullptr;
+        return orphans;
+    }
+
+    static std::mutex& _get_orphans_mutex() {
+        static std::mutex mtx;
+        return mtx;
+    }
+};
+
+#if SAFE_PTR_POSIX_BOOL
+// Maps storage with mmap() and unmaps it with munmap(). allocate() maps
+// anonymous memory, with an alignment of at most a page. The storage of the
+// SafePtrs returned by SafePtr::map_file() is a mapping of a file, which
+// free() unmaps in the same way.
+struct MmapAllocator
+{
+    static constexpr bool requires_free = true;
+
+    static void* allocate(const size_t bytes, const size_t alignment) {
+        if (alignment > _get_page_size()) {
+            throw std::invalid_argument(
+                "MmapAllocator can not align memory to more than a page"
+            );
+        }
+        void* const storage = mmap(
+            nullptr, _get_length(bytes), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+        );
+        if (storage == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        return storage;
+    }
+
+    // `storage` may be anywhere in the first page of the mapping.
+    static void deallocate(void* const storage, const size_t bytes, size_t) {
+        const std::uintptr_t address =
+            reinterpret_cast<std::uintptr_t>(storage);
+        const std::uintptr_t first =
+            address & ~static_cast<std::uintptr_t>(_get_page_size() - 1);
+        munmap(
+            reinterpret_cast<void*>(first),
+            _get_length(static_cast<size_t>(address - first) + bytes)
+        );
+    }
+
+private:
+    // Every mapping takes at least a page, so empty storage also has a
+    // unique address.
+    static size_t _get_length(const size_t bytes) {
+        const size_t length = _get_mapping_length(bytes);
+        return length == 0 ? _get_page_size() : length;
+    }
+};
+#endif
+
+// Whether moving a T to another address and not destroying the original is
+// the same as copying its bytes, which lets SafePtr::resize() move elements
+// with memcpy() or have the allocator move them. It can be specialized for
+// types that are not trivially copyable but still have this property, e.g.
+// types that only hold a pointer to memory they own.
+template<typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template<typename... Fields>
+class SafeSoA;
+
+#if SAFE_PTR_POSIX_BOOL
+template<typename... Ptrs>
+void save_all(int fd, const Ptrs&... safe_ptrs);
+
+template<typename... Ptrs>
+void load_all(int fd, Ptrs&... safe_ptrs);
+#endif
+
+// Where memory is allocated. The constructors and functions that allocate
+// take one as their last parameter, which defaults to the place they are
+// called from (with GCC, Clang and MSVC), so SAFE_PTR_DEBUG can tell which
+// calls leak. It is not used otherwise.
+struct AllocationSite
+{
+    const char* file;
+    int line;
+    const char* function;
+
+#if SAFE_PTR_SITE_BOOL
+    explicit AllocationSite(
+        const char* const file = __builtin_FILE(),
+        const int line = __builtin_LINE(),
+        const char* const function = __builtin_FUNCTION()
+    ) : file(file), line(line), function(function) {}
+#else
+    explicit AllocationSite(
+        const char* const file = "unknown file",
+        const int line = 0,
+        const char* const function = "unknown function"
+    ) : file(file), line(line), function(function) {}
+#endif
+};
+
+#if SAFE_PTR_DEBUG_BOOL || SAFE_PTR_STATS_BOOL
+    template<typename T>
+    const char* _get_type_name() {
+        #if defined(__GXX_RTTI) || defined(_CPPRTTI) || defined(__cpp_rtti)
+            return typeid(T).name();
+        #else
+            return "unknown type";
+        #endif
+    }
+
+    inline std::string _demangle(const char* const name) {
+        #if (defined(__GNUC__) || defined(__clang__)) && \
+            (defined(__GXX_RTTI) || defined(__cpp_rtti))
+            int status = 0;
+            char* const demangled = abi::__cxa_demangle(
+                name, nullptr, nullptr, &status
+            );
+            if (status == 0 && demangled != nullptr) {
+                const std::string result(demangled);
+                std::free(demangled);
+                return result;
+            }
+        #endif
+        return name;
+    }
+#endif
+
+// What allocation_sites() reports for the allocations of one type at one
+// site: those that were not freed yet, and those that were leaked, i.e.
+// whose last SafePtr was destroyed before free() was called.
+struct AllocationSiteStats
+{
+    AllocationSite site;
+    std::string type;
+    size_t live_count;
+    size_t live_bytes;
+    size_t leaked_count;
+    size_t leaked_bytes;
+};
+
+#if SAFE_PTR_DEBUG_BOOL
+    // Allocation site registry
+    //
+    // Records point to the _SiteStats of the site and element type they were
+    // allocated with, whose counters are updated with atomics when the
+    // memory is allocated, freed or leaked. Stats are never erased, so the
+    // pointers stay valid, and the registry is never destroyed, so SafePtrs
+    // with static storage duration can still use it at exit. Sites are
+    // looked up by the addresses of their strings, so the same site may
+    // have several entries, which allocation_sites() merges.
+
+    #if SAFE_PTR_BACKTRACE_BOOL
+        struct _Backtrace {
+            void* frames[SAFE_PTR_DEBUG_BACKTRACE_DEPTH];
+            int depth;
+        };
+    #endif
+
+    struct _SiteStats {
+        AllocationSite site;
+        const char* type;
+        std::atomic<size_t> live_count;
+        std::atomic<size_t> live_bytes;
+        std::atomic<size_t> leaked_count;
+        std::atomic<size_t> leaked_bytes;
+        #if SAFE_PTR_BACKTRACE_BOOL
+            std::atomic<_Backtrace*> leak_backtrace; // of the first leak
+        #endif
+
+        _SiteStats(const AllocationSite& site, const char* const type)
+            : site(site), type(type), live_count(0), live_bytes(0),
+              leaked_count(0), leaked_bytes(0)
+        {
+            #if SAFE_PTR_BACKTRACE_BOOL
+                leak_backtrace.store(nullptr, std::memory_order_relaxed);
+            #endif
+        }
+    };
+
+    // Record of memory tracked in debug mode (see SafePtr::_Record).
+    struct _MemoryRecord {
+        std::atomic<size_t> ref_count;
+        std::atomic<bool> is_deleted;
+        size_t size; // number of elements
+        _SiteStats* site; // nullptr for records of no memory
+        std::atomic<bool> is_live; // whether `site` counts the memory
+        #if SAFE_PTR_BACKTRACE_BOOL
+            _Backtrace* backtrace; // nullptr if it was not sampled
+        #endif
+    };
+
+    struct _SiteKey {
+        const char* file;
+        int line;
+        const char* function;
+        const char* type;
+
+        bool operator==(const _SiteKey& other) const {
+            return file == other.file && line == other.line &&
+                function == other.function && type == other.type;
+        }
+    };
+
+    struct _SiteKeyHash {
+        size_t operator()(const _SiteKey& key) const {
+            const std::hash<const void*> hash;
+            return hash(key.file) ^ (hash(key.function) * 31)
+                ^ (hash(key.type) * 961) ^ static_cast<size_t>(key.line);
+        }
+    };
+
+    struct _SiteRegistry {
+        static constexpr size_t SHARD_COUNT = 16; // must be a power of 2
+
+        struct alignas(64) Shard {
+            std::mutex mtx;
+            std::unordered_map<_SiteKey, _SiteStats, _SiteKeyHash> sites;
+        };
+
+        Shard shards[SHARD_COUNT];
+    };
+
+    #ifdef SAFE_PTR_DEBUG_LEAK_REPORT
+        // Prints the allocation report at exit if memory is still allocated
+        // or was leaked. It is constructed right after the registry, so it is
+        // destroyed after every SafePtr with static storage duration that
+        // allocated memory.
+        struct _LeakReporter {
+            ~_LeakReporter();
+        };
+    #endif
+
+    inline _SiteRegistry& _get_site_registry() {
+        static typename std::aligned_storage<
+            sizeof(_SiteRegistry), alignof(_SiteRegistry)
+        >::type storage;
+        static _SiteRegistry* const registry = new (&storage) _SiteRegistry;
+        #ifdef SAFE_PTR_DEBUG_LEAK_REPORT
+            static _LeakReporter reporter;
+        #endif
+        return *registry;
+    }
+
+    // The site given to the innermost allocating call of this thread that
+    // is running, or nullptr.
+    inline const AllocationSite*& _get_current_site() {
+        static thread_local const AllocationSite* site = nullptr;
+        return site;
+    }
+
+    inline const AllocationSite& _get_unknown_site() {
+        static const AllocationSite site(
+            "unknown file", 0, "unknown function"
+        );
+        return site;
+    }
+
+    // Returns whether the next allocation of this thread is tracked. With
+    // SAFE_PTR_DEBUG_SAMPLE_RATE defined as N, one in N allocations is, on
+    // average: after each tracked allocation, a random number of allocations
+    // between 0 and 2N-2 is skipped, so allocations made in a repeating
+    // pattern are not always all skipped.
+    inline bool _get_is_sampled() {
+        #ifdef SAFE_PTR_DEBUG_SAMPLE_RATE
+            static_assert(
+                SAFE_PTR_DEBUG_SAMPLE_RATE >= 1,
+                "SAFE_PTR_DEBUG_SAMPLE_RATE must be at least 1"
+            );
+            static thread_local size_t skipped = 0;
+            if (skipped != 0) {
+                --skipped;
+                return false;
+            }
+            // xorshift64, seeded differently in each thread
+            static thread_local std::uint64_t state =
+                reinterpret_cast<std::uintptr_t>(&skipped) | 1;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            skipped = static_cast<size_t>(
+                state % (2 * std::uint64_t(SAFE_PTR_DEBUG_SAMPLE_RATE) - 1)
+            );
+        #endif
+        return true;
+    }
+
+    // Returns the stats of the current site for allocations of `type`. The
+    // last ones found by this thread are cached, since the same site often
+    // allocates many times in a row.
+    inline _SiteStats* _get_site_stats(const char* const type) {
+        const AllocationSite* site = _get_current_site();
+        if (site == nullptr) {
+            site = &_get_unknown_site();
+        }
+        const _SiteKey key = {site->file, site->line, site->function, type};
+        static thread_local _SiteKey cached_key = {nullptr, 0, nullptr, nullptr};
+        static thread_local _SiteStats* cached_stats = nullptr;
+        if (cached_stats != nullptr && key == cached_key) {
+            return cached_stats;
+        }
+        _SiteRegistry& registry = _get_site_registry();
+        _SiteRegistry::Shard& shard = registry.shards[
+            _SiteKeyHash()(key) & (_SiteRegistry::SHARD_COUNT - 1)
+        ];
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto found = shard.sites.find(key);
+        if (found == shard.sites.end()) {
+            found = shard.sites.emplace(
+                std::piecewise_construct,
+                std::forward_as_tuple(key),
+                std::forward_as_tuple(*site, type)
+            ).first;
+        }
+        cached_key = key;
+        cached_stats = &found->second;
+        return cached_stats;
+    }
+
+    #if SAFE_PTR_BACKTRACE_BOOL
+        // Captures the stack of one in SAFE_PTR_DEBUG_BACKTRACE allocations
+        // of each thread, and returns nullptr for the others.
+        inline _Backtrace* _sample_backtrace() {
+            static thread_local size_t countdown = 0;
+            if (countdown != 0) {
+                --countdown;
+                return nullptr;
+            }
+            countdown = (SAFE_PTR_DEBUG_BACKTRACE) - 1;
+            _Backtrace* const backtrace = new _Backtrace;
+            backtrace->depth = ::backtrace(
+                backtrace->frames, SAFE_PTR_DEBUG_BACKTRACE_DEPTH
+            );
+            return backtrace;
+        }
+
+        inline void _print_backtrace(
+            std::ostream& out, const _Backtrace& backtrace
+        ) {
+            char** const symbols = backtrace_symbols(
+                backtrace.frames, backtrace.depth
+            );
+            for (int i = 0; i != backtrace.depth; ++i) {
+                out << "        " << (symbols != nullptr ? symbols[i] : "?")
+                    << "\n";
+            }
+            std::free(symbols);
+        }
+    #endif
+#endif
+
+// Sets the site that the allocations made while it exists are attributed
+// to, for the allocating constructors and functions of SafePtr.
+class _SiteScope
+{
+public:
+    #if SAFE_PTR_DEBUG_BOOL
+        explicit _SiteScope(const AllocationSite& site)
+            : _previous(_get_current_site())
+        {
+            _get_current_site() = &site;
+        }
+
+        ~_SiteScope() {
+            _get_current_site() = _previous;
+        }
+
+    private:
+        const AllocationSite* _previous;
+    #else
+        explicit _SiteScope(const AllocationSite&) {}
+    #endif
+
+    _SiteScope(const _SiteScope&) = delete;
+    _SiteScope& operator=(const _SiteScope&) = delete;
+};
+
+// Returns the allocations of every site and element type that still have
+// memory allocated or leaked memory, sorted by their total bytes. Sites are
+// only tracked in SAFE_PTR_DEBUG mode; otherwise, it is empty.
+inline std::vector<AllocationSiteStats> allocation_sites() {
+    std::vector<AllocationSiteStats> stats;
+    #if SAFE_PTR_DEBUG_BOOL
+        _SiteRegistry& registry = _get_site_registry();
+        for (auto& shard : registry.shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (const auto& entry : shard.sites) {
+                const _SiteStats& site = entry.second;
+                const AllocationSiteStats current = {
+                    site.site, _demangle(site.type),
+                    site.live_count.load(std::memory_order_relaxed),
+                    site.live_bytes.load(std::memory_order_relaxed),
+                    site.leaked_count.load(std::memory_order_relaxed),
+                    site.leaked_bytes.load(std::memory_order_relaxed)
+                };
+                if (current.live_count == 0 && current.leaked_count == 0) {
+                    continue;
+                }
+                // the same site may have several entries (see above)
+                auto same = std::find_if(
+                    stats.begin(), stats.end(),
+                    [&](const AllocationSiteStats& other) {
+                        return other.site.line == current.site.line &&
+                            other.type == current.type &&
+                            std::strcmp(other.site.file, current.site.file)
+                                == 0 &&
+                            std::strcmp(
+                                other.site.function, current.site.function
+                            ) == 0;
+                    }
+                );
+                if (same == stats.end()) {
+                    stats.push_back(current);
+                } else {
+                    same->live_count += current.live_count;
+                    same->live_bytes += current.live_bytes;
+                    same->leaked_count += current.leaked_count;
+                    same->leaked_bytes += current.leaked_bytes;
+                }
+            }
+        }
+        std::sort(
+            stats.begin(), stats.end(),
+            [](const AllocationSiteStats& a, const AllocationSiteStats& b) {
+                return a.live_bytes + a.leaked_bytes >
+                    b.live_bytes + b.leaked_bytes;
+            }
+        );
+    #endif
+    return stats;
+}
+
+// Prints the totals of allocation_sites() per site and per element type,
+// sorted by bytes. If SAFE_PTR_DEBUG_LEAK_REPORT is defined, it is printed
+// to std::cerr at exit when memory is still allocated or was leaked.
+inline void print_allocation_report(std::ostream& out = std::cerr) {
+    const std::vector<AllocationSiteStats> sites = allocation_sites();
+    std::vector<AllocationSiteStats> types;
+    size_t live_count = 0, live_bytes = 0, leaked_count = 0, leaked_bytes = 0;
+    for (const AllocationSiteStats& site : sites) {
+        live_count += site.live_count;
+        live_bytes += site.live_bytes;
+        leaked_count += site.leaked_count;
+        leaked_bytes += site.leaked_bytes;
+        auto same = std::find_if(
+            types.begin(), types.end(),
+            [&](const AllocationSiteStats& type) {
+                return type.type == site.type;
+            }
+        );
+        if (same == types.end()) {
+            types.push_back(site);
+        } else {
+            same->live_count += site.live_count;
+            same->live_bytes += site.live_bytes;
+            same->leaked_count += site.leaked_count;
+            same->leaked_bytes += site.leaked_bytes;
+        }
+    }
+    std::sort(
+        types.begin(), types.end(),
+        [](const AllocationSiteStats& a, const AllocationSiteStats& b) {
+            return a.live_bytes + a.leaked_bytes >
+                b.live_bytes + b.leaked_bytes;
+        }
+    );
+
+    std::ostringstream text;
+    text << "SafePtr allocation report: " << live_bytes << " bytes in "
+         << live_count << " allocations live, " << leaked_bytes
+         << " bytes in " << leaked_count << " allocations leaked\n";
+    if (!sites.empty()) {
+        text << "  by site:\n";
+    }
+    for (const AllocationSiteStats& site : sites) {
+        text << "    " << site.live_bytes << " bytes live (" << site.live_count
+             << "), " << site.leaked_bytes << " bytes leaked ("
+             << site.leaked_count << ") at " << site.site.file << ":"
+             << site.site.line << " in " << site.site.function << " ["
+             << site.type << "]\n";
+    }
+    #if SAFE_PTR_BACKTRACE_BOOL
+        _SiteRegistry& registry = _get_site_registry();
+        for (auto& shard : registry.shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (const auto& entry : shard.sites) {
+                const _Backtrace* const backtrace =
+                    entry.second.leak_backtrace.load(std::memory_order_acquire);
+                if (backtrace != nullptr) {
+                    text << "  first leak at " << entry.second.site.file << ":"
+                         << entry.second.site.line << ":\n";
+                    _print_backtrace(text, *backtrace);
+                }
+            }
+        }
+    #endif
+    if (!types.empty()) {
+        text << "  by type:\n";
+    }
+    for (const AllocationSiteStats& type : types) {
+        text << "    " << type.live_bytes << " bytes live (" << type.live_count
+             << "), " << type.leaked_bytes << " bytes leaked ("
+             << type.leaked_count << ") of " << type.type << "\n";
+    }
+    const std::string report = text.str();
+    out.write(report.data(), static_cast<std::streamsize>(report.size()));
+}
+
+#if SAFE_PTR_DEBUG_BOOL && defined(SAFE_PTR_DEBUG_LEAK_REPORT)
+    inline _LeakReporter::~_LeakReporter() {
+        const std::vector<AllocationSiteStats> sites = allocation_sites();
+        if (!sites.empty()) {
+            print_allocation_report(std::cerr);
+        }
+    }
+#endif
+
+// What safe_ptr_stats() reports for the storage of one element type.
+struct SafePtrTypeStats
+{
+    std::string type;
+    size_t allocations;
+    size_t frees;
+    size_t live_count;
+    size_t live_bytes;
+};
+
+// Snapshot of the storage given to SafePtrs since the program started,
+// returned by safe_ptr_stats(). A resize() that moves the elements counts
+// as a free and an allocation. Memory of allocators that do not require
+// free() (e.g. ArenaAllocator) stays live until free() is called. Without
+// SAFE_PTR_STATS, every field is 0 or empty.
+struct SafePtrStats
+{
+    size_t allocations;
+    size_t frees;
+    size_t live_count;
+    size_t live_bytes;
+    // Highest live_bytes seen. Each thread adds its allocations to it once
+    // they add up to SAFE_PTR_STATS_FLUSH_BYTES, so it may be lower than
+    // the real peak by that much for each thread.
+    size_t peak_bytes;
+    // size_histogram[i] is the number of allocations of 2^(i-1) bytes up to
+    // 2^i - 1 bytes, and size_histogram[0] of those of 0 bytes.
+    std::array<size_t, std::numeric_limits<size_t>::digits + 1>
+        size_histogram;
+    std::vector<SafePtrTypeStats> types; // sorted by live_bytes
+};
+
+#if SAFE_PTR_STATS_BOOL
+    // Allocation statistics
+    //
+    // Each thread counts its allocations and frees in a _ThreadStats of its
+    // own, which is aligned to cache lines. Only that thread writes to it,
+    // so the counters are updated with a relaxed load and store instead of
+    // a read-modify-write, and safe_ptr_stats() can read them at any time.
+    // When a thread exits, its _ThreadStats is given to the next thread
+    // that starts counting, so the counts are never lost. Frees made while
+    // the thread exits, after that, are counted in a _ThreadStats shared by
+    // every thread, with atomic additions. Element types get an index
+    // when they are first counted, until there are SAFE_PTR_STATS_MAX_TYPES
+    // of them; the types after that share the last index.
+
+    constexpr size_t _STATS_SIZE_CLASS_COUNT =
+        std::numeric_limits<size_t>::digits + 1;
+
+    struct _TypeCounters {
+        std::atomic<size_t> allocations;
+        std::atomic<size_t> frees;
+        std::atomic<size_t> allocated_bytes;
+        std::atomic<size_t> freed_bytes;
+    };
+
+    struct alignas(64) _ThreadStats {
+        _TypeCounters types[SAFE_PTR_STATS_MAX_TYPES];
+        std::atomic<size_t> size_histogram[_STATS_SIZE_CLASS_COUNT];
+        std::ptrdiff_t unflushed_bytes; // live bytes not in the registry
+        bool is_shared;
+        _ThreadStats* next_orphan;
+    };
+
+    struct _StatsRegistry {
+        std::mutex mtx;
+        std::vector<_ThreadStats*> threads; // never freed
+        _ThreadStats* orphans;
+        const char* type_names[SAFE_PTR_STATS_MAX_TYPES];
+        size_t type_count;
+        std::atomic<std::ptrdiff_t> live_bytes; // flushed by the threads
+        std::atomic<size_t> peak_bytes;
+        _ThreadStats exited;
+    };
+
+    // Like the site registry, it is never destroyed, so SafePtrs with
+    // static storage duration can still be counted at exit.
+    inline _StatsRegistry& _get_stats_registry() {
+        static typename std::aligned_storage<
+            sizeof(_StatsRegistry), alignof(_StatsRegistry)
+        >::type storage;
+        static _StatsRegistry* const registry = [] {
+            _StatsRegistry* const created = new (&storage) _StatsRegistry();
+            created->exited.is_shared = true;
+            return created;
+        }();
+        return *registry;
+    }
+
+    // Returns the index of the counters of the element type `type`.
+    inline size_t _add_stats_type(const char* const type) {
+        _StatsRegistry& registry = _get_stats_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        if (registry.type_count == SAFE_PTR_STATS_MAX_TYPES - 1) {
+            return SAFE_PTR_STATS_MAX_TYPES - 1;
+        }
+        registry.type_names[registry.type_count] = type;
+        return registry.type_count++;
+    }
+
+    template<typename T>
+    size_t _get_stats_type_index() {
+        static const size_t index = _add_stats_type(_get_type_name<T>());
+        return index;
+    }
+
+    // Adds `bytes` to the live bytes of the registry and updates the peak.
+    inline void _flush_live_bytes(const std::ptrdiff_t bytes) {
+        _StatsRegistry& registry = _get_stats_registry();
+        const std::ptrdiff_t live = registry.live_bytes.fetch_add(
+            bytes, std::memory_order_relaxed
+        ) + bytes;
+        if (live <= 0) {
+            return;
+        }
+        size_t peak = registry.peak_bytes.load(std::memory_order_relaxed);
+        while (
+            static_cast<size_t>(live) > peak &&
+            !registry.peak_bytes.compare_exchange_weak(
+                peak, static_cast<size_t>(live), std::memory_order_relaxed
+            )
+        ) {}
+    }
+
+    // The _ThreadStats of this thread, or nullptr before it counts
+    // anything.
+    inline _ThreadStats*& _get_current_thread_stats() {
+        static thread_local _ThreadStats* current = nullptr;
+        return current;
+    }
+
+    // Takes a _ThreadStats for this thread, and gives it back when the
+    // thread exits.
+    struct _ThreadStatsOwner {
+        _ThreadStats* stats;
+
+        _ThreadStatsOwner() {
+            _StatsRegistry& registry = _get_stats_registry();
+            {
+                std::lock_guard<std::mutex> lock(registry.mtx);
+                stats = registry.orphans;
+                if (stats != nullptr) {
+                    registry.orphans = stats->next_orphan;
+                }
+            }
+            if (stats == nullptr) {
+                void* const storage = DefaultAllocator::allocate(
+                    sizeof(_ThreadStats), alignof(_ThreadStats)
+                );
+                stats = new (storage) _ThreadStats();
+                std::lock_guard<std::mutex> lock(registry.mtx);
+                registry.threads.push_back(stats);
+            }
+            _get_current_thread_stats() = stats;
+        }
+
+        ~_ThreadStatsOwner() {
+            _StatsRegistry& registry = _get_stats_registry();
+            _get_current_thread_stats() = &registry.exited;
+            _flush_live_bytes(stats->unflushed_bytes);
+            stats->unflushed_bytes = 0;
+            std::lock_guard<std::mutex> lock(registry.mtx);
+            stats->next_orphan = registry.orphans;
+            registry.orphans = stats;
+        }
+    };
+
+    inline _ThreadStats& _get_thread_stats() {
+        _ThreadStats* const current = _get_current_thread_stats();
+        if (current != nullptr) {
+            return *current;
+        }
+        static thread_local _ThreadStatsOwner owner;
+        return *owner.stats;
+    }
+
+    inline void _add_to_counter(
+        _ThreadStats& stats, std::atomic<size_t>& counter, const size_t value
+    ) {
+        if (stats.is_shared) {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        } else {
+            counter.store(
+                counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed
+            );
+        }
+    }
+
+    inline void _add_live_bytes(_ThreadStats& stats, std::ptrdiff_t bytes) {
+        if (!stats.is_shared) {
+            stats.unflushed_bytes += bytes;
+            if (
+                stats.unflushed_bytes < SAFE_PTR_STATS_FLUSH_BYTES &&
+                stats.unflushed_bytes > -SAFE_PTR_STATS_FLUSH_BYTES
+            ) {
+                return;
+            }
+            bytes = stats.unflushed_bytes;
+            stats.unflushed_bytes = 0;
+        }
+        _flush_live_bytes(bytes);
+    }
+
+    // Returns the index of the size_histogram entry of `bytes`.
+    inline size_t _get_stats_size_class(size_t bytes) {
+        #if defined(__GNUC__) || defined(__clang__)
+            return bytes == 0 ? 0 :
+                std::numeric_limits<unsigned long long>::digits -
+                __builtin_clzll(bytes);
+        #else
+            size_t size_class = 0;
+            for (; bytes != 0; bytes >>= 1) {
+                ++size_class;
+            }
+            return size_class;
+        #endif
+    }
+
+    inline void _count_allocation(const size_t type, const size_t bytes) {
+        _ThreadStats& stats = _get_thread_stats();
+        _TypeCounters& counters = stats.types[type];
+        _add_to_counter(stats, counters.allocations, 1);
+        _add_to_counter(stats, counters.allocated_bytes, bytes);
+        _add_to_counter(
+            stats, stats.size_histogram[_get_stats_size_class(bytes)], 1
+        );
+        _add_live_bytes(stats, static_cast<std::ptrdiff_t>(bytes));
+    }
+
+    inline void _count_free(const size_t type, const size_t bytes) {
+        _ThreadStats& stats = _get_thread_stats();
+        _TypeCounters& counters = stats.types[type];
+        _add_to_counter(stats, counters.frees, 1);
+        _add_to_counter(stats, counters.freed_bytes, bytes);
+        _add_live_bytes(stats, -static_cast<std::ptrdiff_t>(bytes));
+    }
+#endif
+
+// Returns the number of allocations, frees and bytes of the storage of
+// every SafePtr, in total and per element type, in SAFE_PTR_STATS mode.
+// It can be called at any time from any thread; the counts of allocations
+// made while it runs may or may not be included.
+inline SafePtrStats safe_ptr_stats() {
+    SafePtrStats stats = SafePtrStats();
+    #if SAFE_PTR_STATS_BOOL
+        _StatsRegistry& registry = _get_stats_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        std::vector<_ThreadStats*> threads = registry.threads;
+        threads.push_back(&registry.exited);
+        size_t allocated_bytes = 0, freed_bytes = 0;
+        for (size_t index = 0; index != SAFE_PTR_STATS_MAX_TYPES; ++index) {
+            SafePtrTypeStats type = {
+                index < registry.type_count ?
+                    _demangle(registry.type_names[index]) : "other types",
+                0, 0, 0, 0
+            };
+            size_t type_freed_bytes = 0;
+            for (const _ThreadStats* const thread : threads) {
+                const _TypeCounters& counters = thread->types[index];
+                type.allocations +=
+                    counters.allocations.load(std::memory_order_relaxed);
+                type.frees += counters.frees.load(std::memory_order_relaxed);
+                type.live_bytes +=
+                    counters.allocated_bytes.load(std::memory_order_relaxed);
+                type_freed_bytes +=
+                    counters.freed_bytes.load(std::memory_order_relaxed);
+            }
+            if (type.allocations == 0) {
+                continue;
+            }
+            stats.allocations += type.allocations;
+            stats.frees += type.frees;
+            allocated_bytes += type.live_bytes;
+            freed_bytes += type_freed_bytes;
+            // frees made while reading may be seen without their allocation
+            type.live_count = type.allocations > type.frees ?
+                type.allocations - type.frees : 0;
+            type.live_bytes = type.live_bytes > type_freed_bytes ?
+                type.live_bytes - type_freed_bytes : 0;
+            // the same type may have several indices, e.g. one in each
+            // shared library
+            auto same = std::find_if(
+                stats.types.begin(), stats.types.end(),
+                [&](const SafePtrTypeStats& other) {
+                    return other.type == type.type;
+                }
+            );
+            if (same == stats.types.end()) {
+                stats.types.push_back(type);
+            } else {
+                same->allocations += type.allocations;
+                same->frees += type.frees;
+                same->live_count += type.live_count;
+                same->live_bytes += type.live_bytes;
+            }
+        }
+        for (const _ThreadStats* const thread : threads) {
+            for (size_t i = 0; i != _STATS_SIZE_CLASS_COUNT; ++i) {
+                stats.size_histogram[i] +=
+                    thread->size_histogram[i].load(std::memory_order_relaxed);
+            }
+        }
+        stats.live_count = stats.allocations > stats.frees ?
+            stats.allocations - stats.frees : 0;
+        stats.live_bytes = allocated_bytes > freed_bytes ?
+            allocated_bytes - freed_bytes : 0;
+        stats.peak_bytes = std::max(
+            registry.peak_bytes.load(std::memory_order_relaxed),
+            stats.live_bytes
+        );
+        std::sort(
+            stats.types.begin(), stats.types.end(),
+            [](const SafePtrTypeStats& a, const SafePtrTypeStats& b) {
+                return a.live_bytes > b.live_bytes;
+            }
+        );
+    #endif
+    return stats;
+}
+
+#if SAFE_PTR_QUARANTINE_BOOL
+    // Freed storage and guards (see SAFE_PTR_DEBUG_QUARANTINE)
+    //
+    // Storage is allocated with a guard before the elements and one after
+    // them, both filled with _GUARD_BYTE, and free() checks that they are
+    // intact. Freed storage is then filled with _POISON_BYTE and kept in a
+    // ring of at most SAFE_PTR_DEBUG_QUARANTINE_COUNT blocks and about
+    // SAFE_PTR_DEBUG_QUARANTINE_BYTES bytes. When a block leaves the ring to
+    // make room for newer ones, it is checked to still be poisoned before it
+    // is returned to its allocator. Storage bigger than the ring is returned
+    // right away.
+    constexpr unsigned char _GUARD_BYTE = 0xFD;
+    constexpr unsigned char _POISON_BYTE = 0xDD;
+
+    struct _QuarantinedBlock {
+        unsigned char* storage; // the first byte of the front guard
+        size_t bytes; // including both guards
+        size_t alignment;
+        void (*deallocate)(void*, size_t, size_t);
+    };
+
+    struct _Quarantine {
+        std::mutex mtx;
+        _QuarantinedBlock blocks[SAFE_PTR_DEBUG_QUARANTINE_COUNT];
+        size_t first; // index of the oldest block
+        size_t count;
+        size_t bytes;
+    };
+
+    // Like the site registry, it is never destroyed, so SafePtrs with
+    // static storage duration can still be freed at exit.
+    inline _Quarantine& _get_quarantine() {
+        static typename std::aligned_storage<
+            sizeof(_Quarantine), alignof(_Quarantine)
+        >::type storage;
+        static _Quarantine* const quarantine = new (&storage) _Quarantine();
+        return *quarantine;
+    }
+
+    // Size of the guard in front of elements aligned to `alignment`, which
+    // keeps them aligned.
+    inline size_t _get_front_guard_bytes(const size_t alignment) {
+        return (SAFE_PTR_DEBUG_GUARD_BYTES + alignment - 1) /
+            alignment * alignment;
+    }
+
+    // Whether every byte of [data, data + bytes) is `byte`. It does not stop
+    // at the first mismatch, so the loop can be vectorized.
+    inline bool _is_filled_with(
+        const unsigned char* const data, const size_t bytes,
+        const unsigned char byte
+    ) {
+        unsigned char difference = 0;
+        for (size_t i = 0; i != bytes; ++i) {
+            difference |= data[i] ^ byte;
+        }
+        return difference == 0;
+    }
+
+    // Returns a block that left the quarantine to its allocator. Returns
+    // false if it was written after it was freed.
+    inline bool _release_quarantined(const _QuarantinedBlock& block) {
+        const bool is_intact =
+            _is_filled_with(block.storage, block.bytes, _POISON_BYTE);
+        block.deallocate(block.storage, block.bytes, block.alignment);
+        return is_intact;
+    }
+
+    // Takes the oldest block out of the quarantine if it holds more than
+    // `max_count` blocks or `max_bytes` bytes.
+    inline bool _take_quarantined(
+        _QuarantinedBlock& oldest, const size_t max_count,
+        const size_t max_bytes
+    ) {
+        _Quarantine& quarantine = _get_quarantine();
+        std::lock_guard<std::mutex> lock(quarantine.mtx);
+        if (quarantine.count == 0 || (
+            quarantine.count <= max_count && quarantine.bytes <= max_bytes
+        )) {
+            return false;
+        }
+        oldest = quarantine.blocks[quarantine.first];
+        quarantine.first =
+            (quarantine.first + 1) % SAFE_PTR_DEBUG_QUARANTINE_COUNT;
+        --quarantine.count;
+        quarantine.bytes -= oldest.bytes;
+        return true;
+    }
+
+    // Puts a poisoned block in the quarantine and releases the blocks that
+    // leave it. Returns how many of those were written after being freed.
+    inline size_t _quarantine(const _QuarantinedBlock& block) {
+        _QuarantinedBlock oldest;
+        bool is_full;
+        {
+            _Quarantine& quarantine = _get_quarantine();
+            std::lock_guard<std::mutex> lock(quarantine.mtx);
+            is_full = quarantine.count == SAFE_PTR_DEBUG_QUARANTINE_COUNT;
+            if (is_full) {
+                oldest = quarantine.blocks[quarantine.first];
+                quarantine.first = (quarantine.first + 1) %
+                    SAFE_PTR_DEBUG_QUARANTINE_COUNT;
+                --quarantine.count;
+                quarantine.bytes -= oldest.bytes;
+            }
+            quarantine.blocks[
+                (quarantine.first + quarantine.count) %
+                    SAFE_PTR_DEBUG_QUARANTINE_COUNT
+            ] = block;
+            ++quarantine.count;
+            quarantine.bytes += block.bytes;
+        }
+        size_t written_count = 0;
+        if (is_full && !_release_quarantined(oldest)) {
+            ++written_count;
+        }
+        while (_take_quarantined(
+            oldest, SAFE_PTR_DEBUG_QUARANTINE_COUNT,
+            SAFE_PTR_DEBUG_QUARANTINE_BYTES
+        )) {
+            if (!_release_quarantined(oldest)) {
+                ++written_count;
+            }
+        }
+        return written_count;
+    }
+#endif
+
+// Releases every block held in the quarantine in SAFE_PTR_DEBUG_QUARANTINE
+// mode and returns how many of them were written after they were freed.
+inline size_t flush_quarantine() {
+    size_t written_count = 0;
+    #if SAFE_PTR_QUARANTINE_BOOL
+        _QuarantinedBlock oldest;
+        while (_take_quarantined(oldest, 0, 0)) {
+            if (!_release_quarantined(oldest)) {
+                ++written_count;
+            }
+        }
+    #endif
+    return written_count;
+}
+
+// `Alignment` is the alignment in bytes of the first element. It must be a
+// power of 2 that is not smaller than alignof(T), e.g. 64 for cache lines or
+// SIMD registers and 4096 for pages. `Alloc` provides the storage (see
+// "Allocators" above).
+template<
+    typename T,
+    size_t Alignment = alignof(T),
+    typename Alloc = DefaultAllocator
+>
+class SafePtr
+{
+    static_assert(
+        Alignment != 0 && (Alignment & (Alignment-1)) == 0,
+        "SafePtr alignment must be a power of 2"
+    );
+    static_assert(
+        Alignment >= alignof(T),
+        "SafePtr alignment must not be smaller than alignof(T)"
+    );
+
+public:
+    // constructor
+    SafePtr() : _begin(nullptr), _end(nullptr) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _memory_id = _get_is_sampled() ?
+                _new_record(true) : _UNSAMPLED_MEMORY_ID;
+        #endif
+    }
+
+    // constructor
+    SafePtr(
+        const size_t size, const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _construct_default(size);
+    }
+
+    // constructor
+    SafePtr(
+        const size_t size,
+        const T& value,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _construct_fill(size, value);
+    }
+
+    // constructor
+    SafePtr(
+        const size_t size,
+        const T& value,
+        const FirstTouch& first_touch,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _allocate(size);
+        try {
+            _first_touch(
+                first_touch,
+                [&value](T* const first, T* const last) {
+                    if (std::is_trivially_copyable<T>::value) {
+                        _fill_bytes_of(first, last, value);
+                    } else {
+                        std::uninitialized_fill(first, last, value);
+                    }
+                },
+                &_destroy
+            );
+        } catch (...) {
+            _deallocate_uninitialized();
+            throw;
+        }
+    }
+
+    // constructor
+    SafePtr(
+        const std::initializer_list<T>& il,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _construct_copy(il.begin(), il.end(), il.size());
+    }
+
+    // constructor
+    template<
+        typename InputIt,
+        typename std::enable_if<
+            !std::is_integral<InputIt>::value, int
+        >::type = 0
+    >
+    SafePtr(
+        InputIt first,
+        InputIt last,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _construct_from_range(first, last, 0, _sp_has_subtraction<InputIt>{});
+    }
+
+    // constructor
+    // `size_hint` is the expected number of elements of a range that can
+    // only be read once (e.g. from std::istream_iterator). If it is right,
+    // the elements are read directly into their final storage. Otherwise the
+    // storage grows as needed. For other ranges, the hint is not needed.
+    template<
+        typename InputIt,
+        typename std::enable_if<
+            !std::is_integral<InputIt>::value, int
+        >::type = 0
+    >
+    SafePtr(
+        InputIt first,
+        InputIt last,
+        const size_t size_hint,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _construct_from_range(
+            first, last, size_hint, _sp_has_subtraction<InputIt>{}
+        );
+    }
+
+    // destructor
+    ~SafePtr() noexcept(!SAFE_PTR_TEST_BOOL) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _release_record();
+        #endif
+    }
+
+    // copy constructor
+    SafePtr(
+        const SafePtr& other, const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        #if SAFE_PTR_DEBUG_BOOL
+            other._check_for_use_after_free();
+        #endif
+        _construct_copy(other.begin(), other.end(), other.size());
+    }
+    
+    // move constructor
+    SafePtr(SafePtr&& other) noexcept(!SAFE_PTR_TEST_BOOL) {
+        #if SAFE_PTR_DEBUG_BOOL
+            other._check_for_use_after_free();
+            this->_memory_id = other._memory_id;
+            _acquire_record();
+        #endif
+        this->_begin = other._begin;
+        this->_end = other._end;
+    }
+
+    // copy assignment operator
+    SafePtr& operator=(const SafePtr& other) {
+        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
+            if (this != &other) {
+        #endif
+        #if SAFE_PTR_DEBUG_BOOL
+            // The new memory is attributed to the site of the replaced memory
+            // or else of `other`, unless this is called by a function that
+            // takes an AllocationSite, e.g. assign().
+            const AllocationSite* site = _get_current_site();
+            if (site == nullptr) {
+                site = &_get_allocation_site();
+                if (site == &_get_unknown_site()) {
+                    site = &other._get_allocation_site();
+                }
+            }
+            _SiteScope scope(*site);
+            other._check_for_use_after_free();
+            _release_record();
+            this->_memory_id = 0; // in case the copy below throws
+        #endif
+        _construct_copy(other.begin(), other.end(), other.size());
+        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
+            }
+        #endif
+        return *this;
+    }
+
+    // move assignment operator
+    SafePtr& operator=(SafePtr&& other) noexcept(!SAFE_PTR_TEST_BOOL) {
+        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
+            if (this != &other) {
+        #endif
+        #if SAFE_PTR_DEBUG_BOOL
+            other._check_for_use_after_free();
+            _release_record();
+            this->_memory_id = other._memory_id;
+            _acquire_record();
+        #endif
+        this->_begin = other._begin;
+        this->_end = other._end;
+        #ifndef SAFE_PTR_DISABLE_SELF_ASSIGNING_CHECKING
+            }
+        #endif
+        return *this;
+    }
+
+    void free() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            if (_get_is_view()) {
+                throw std::logic_error(
+                    "it was tried to free the memory of a view"
+                );
+            }
+            // Only the thread that flips the flag may delete the memory, so
+            // two concurrent free() calls can never both deallocate it.
+            if (_has_record()) {
+                _Record& record = _find_record();
+                bool expected = false;
+                if (!record.is_deleted.compare_exchange_strong(
+                    expected, true, std::memory_order_acq_rel
+                )) {
+                    throw std::logic_error(
+                        "it was tried to free the memory of a SafePtr that "
+                        "does not own data."
+                    );
+                }
+                _retire_record(record, false);
+            }
+        #endif
+        _deallocate();
+    }
+
+    // Replaces the elements with copies of those of `other`. If this SafePtr
+    // has the same size as `other`, its memory is reused and the elements
+    // are assigned. Otherwise its memory is freed and new memory is
+    // allocated. This SafePtr must own memory that was not freed or be
+    // default constructed.
+    void assign(
+        const SafePtr& other, const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        #if SAFE_PTR_DEBUG_BOOL
+            other._check_for_use_after_free();
+            _check_can_reuse();
+        #endif
+        if (this == &other) {
+            return;
+        }
+        if (_begin != nullptr && size() == other.size()) {
+            std::copy(other.begin(), other.end(), _begin);
+            return;
+        }
+        if (_begin != nullptr) {
+            free();
+        }
+        *this = other;
+    }
+
+    // Changes the number of elements to `size`. The first elements are
+    // kept, and new ones are default initialized, like in SafePtr(size), or
+    // copies of `value`. The memory is reused if the allocator can resize it
+    // (see "Allocators"), and if not, the elements are moved to new memory,
+    // with memcpy() if T is trivially relocatable. Like after free(), other
+    // SafePtrs that point to the old memory must not be used anymore. This
+    // SafePtr must own memory that was not freed or be default constructed.
+    void resize(
+        const size_t size, const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _resize(
+            size,
+            [](T* first, T* const last) {
+                for (; first != last; ++first) {
+                    ::new (static_cast<void*>(first)) T;
+                }
+            },
+            std::is_nothrow_default_constructible<T>{}
+        );
+    }
+
+    void resize(
+        const size_t size,
+        const T& value,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        _SiteScope scope(site);
+        _resize(
+            size,
+            [&value](T* const first, T* const last) {
+                std::uninitialized_fill(first, last, value);
+            },
+            std::is_nothrow_copy_constructible<T>{}
+        );
+    }
+
+    // Allocates `size` elements without writing to them. Only available for
+    // trivial types, whose elements can be assigned before being read.
+    static SafePtr uninitialized(
+        const size_t size, const AllocationSite& site = AllocationSite()
+    ) {
+        static_assert(
+            std::is_trivial<T>::value,
+            "SafePtr::uninitialized() requires a trivial type"
+        );
+        _SiteScope scope(site);
+        SafePtr safe_ptr(_Uninitialized{}, size);
+        return safe_ptr;
+    }
+
+#if SAFE_PTR_POSIX_BOOL
+    // Maps the file at `path` into memory, without copying it, as an array
+    // of T. Its pages are only read from the file when they are first
+    // accessed. The file size must be a multiple of sizeof(T), and
+    // `Alignment` must not be bigger than a page. free() unmaps the file.
+    static SafePtr<T, Alignment, MmapAllocator> map_file(
+        const char* const path,
+        const MapMode mode = MapMode::read_only,
+        const AllocationSite& site = AllocationSite()
+    ) {
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "SafePtr::map_file() requires a trivially copyable type"
+        );
+        _SiteScope scope(site);
+        using Mapped = SafePtr<T, Alignment, MmapAllocator>;
+        return Mapped(typename Mapped::_MappedFile{}, path, mode);
+    }
+
+    // Writes the elements to `fd` after a header with their size, their
+    // number, the byte order and a checksum, in a single writev() unless it
+    // is interrupted. `fd` is never seeked, so it may also be a pipe or a
+    // socket. Only available for trivially copyable types. save_all() saves
+    // many SafePtrs at once.
+    void save(const int fd) const {
+        save_all(fd, *this);
+    }
+
+    // Creates or truncates the file at `path` and saves the elements to it.
+    void save(const char* const path) const {
+        const int fd = _open_file(path, O_WRONLY | O_CREAT | O_TRUNC);
+        try {
+            save(fd);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        if (close(fd) != 0) {
+            throw std::system_error(
+                errno, std::generic_category(), "failed to close the file"
+            );
+        }
+    }
+
+    // Reads elements written by save() from `fd` straight into the memory
+    // of a new SafePtr. Throws std::invalid_argument if they were not saved
+    // from a SafePtr of the same element size on a machine with the same
+    // byte order, or if the checksum does not match. load_all() loads into
+    // existing SafePtrs.
+    static SafePtr load(
+        const int fd, const AllocationSite& site = AllocationSite()
+    ) {
+        static_assert(
+            std::is_trivially_copyable<T>::value,
+            "SafePtr::load() requires a trivially copyable type"
+        );
+        _SiteScope scope(site);
+        _SerialHeader header;
+        iovec buffer;
+        buffer.iov_base = &header;
+        buffer.iov_len = sizeof(header);
+        _read_buffers(fd, &buffer, 1);
+        _check_serial_header(header, sizeof(T));
+        if (header.count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        SafePtr safe_ptr(_Uninitialized{}, static_cast<size_t>(header.count));
+        try {
+            buffer.iov_base = safe_ptr._begin;
+            buffer.iov_len = static_cast<size_t>(header.count) * sizeof(T);
+            _read_buffers(fd, &buffer, 1);
+            _check_serial_checksum(header, safe_ptr._begin);
+        } catch (...) {
+            safe_ptr._deallocate_uninitialized();
+            throw;
+        }
+        return safe_ptr;
+    }
+
+    static SafePtr load(
+        const char* const path, const AllocationSite& site = AllocationSite()
+    ) {
+        const int fd = _open_file(path, O_RDONLY);
+        try {
+            SafePtr safe_ptr = load(fd, site);
+            close(fd);
+            return safe_ptr;
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+#endif
+
+    // `data` must be aligned to Alignment.
+    static SafePtr make_view(T* const data, const size_t size) {
+        if (reinterpret_cast<std::uintptr_t>(data) % Alignment != 0) {
+            throw std::invalid_argument(
+                "it was tried to make a view of data that is not aligned to "
+                "the SafePtr alignment"
+            );
+        }
+        SafePtr safe_ptr;
+        #if SAFE_PTR_DEBUG_BOOL
+            safe_ptr._release_record();
+            safe_ptr._memory_id = 0;
+        #endif
+        safe_ptr._begin = data;
+        safe_ptr._end = data + size;
+        return safe_ptr;
+    }
+
+    // Returns a view of the `count` elements starting at `offset`, without
+    // copying them. Unlike views from make_view(), in debug mode a subview
+    // is checked for use after the memory it points into is freed. The
+    // first element of the subview must be aligned to Alignment.
+    SafePtr subview(const size_t offset, const size_t count) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        if (offset > size() || count > size() - offset) {
+            throw std::out_of_range(
+                "tried to create a subview out of the SafePtr range"
+            );
+        }
+        SafePtr view = make_view(_begin + offset, count);
+        #if SAFE_PTR_DEBUG_BOOL
+            if (_has_record()) {
+                view._memory_id = _memory_id | _SUBVIEW_BIT;
+                view._acquire_record();
+            }
+        #endif
+        return view;
+    }
+
+    // Like subview(), but the elements of the view can only be read.
+    SafePtr<const T, Alignment, Alloc> subview(
+        const size_t offset, const size_t count
+    ) const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        if (offset > size() || count > size() - offset) {
+            throw std::out_of_range(
+                "tried to create a subview out of the SafePtr range"
+            );
+        }
+        SafePtr<const T, Alignment, Alloc> view =
+            SafePtr<const T, Alignment, Alloc>::make_view(
+                _begin + offset, count
+            );
+        #if SAFE_PTR_DEBUG_BOOL
+            if (_has_record()) {
+                view._memory_id = _memory_id | _SUBVIEW_BIT;
+                view._acquire_record();
+            }
+        #endif
+        return view;
+    }
+
+    size_t size() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return _end - _begin;
+    }
+
+    const T* begin() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return _begin;
+    }
+
+    T* begin() {
+        return const_cast<T*>(
+            const_cast<const SafePtr&>(*this).begin()
+        );
+    }
+
+    const T* cbegin() const {
+        return begin();
+    }
+
+    const T* cbegin() {
+        return const_cast<const SafePtr&>(*this).cbegin();
+    }
+
+    const T* end() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return _end;
+    }
+
+    T* end() {
+        return const_cast<T*>(
+            const_cast<const SafePtr&>(*this).end()
+        );
+    }
+
+    const T* cend() const {
+        return end();
+    }
+
+    const T* cend() {
+        return const_cast<const SafePtr&>(*this).cend();
+    }
+
+    const T& operator[](const size_t index) const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return *(_begin + index);
+    }
+
+    T& operator[](const size_t index) {
+        return const_cast<T&>(
+            const_cast<const SafePtr&>(*this)[index]
+        );
+    }
+
+    const T& at(const size_t index) const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        if (index >= this->size()) {
+            throw std::out_of_range(
+                "tried to access SafePtr element out of range"
+            );
+        }
+        return *(_begin + index);
+    }
+
+    T& at(const size_t index) {
+        return const_cast<T&>(
+            const_cast<const SafePtr&>(*this).at(index)
+        );
+    }
+
+    bool empty() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return this->size() == 0;
+    }
+
+    const T* data() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return _begin;
+    }
+
+    T* data() {
+        return const_cast<T*>(
+            const_cast<const SafePtr&>(*this).data()
+        );
+    }
+
+    // The same as data(), but also tells the compiler that the pointer is
+    // aligned to Alignment, so it can use aligned vector instructions.
+    const T* aligned_data() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        #if defined(__GNUC__) || defined(__clang__)
+            return static_cast<const T*>(
+                __builtin_assume_aligned(_begin, Alignment)
+            );
+        #else
+            return _begin;
+        #endif
+    }
+
+    T* aligned_data() {
+        return const_cast<T*>(
+            const_cast<const SafePtr&>(*this).aligned_data()
+        );
+    }
+
+    const T& front() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return *(this->_begin);
+    }
+
+    T& front() {
+        return const_cast<T&> (
+            const_cast<const SafePtr&>(*this).front()
+        );
+    }
+
+    const T& back() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return *(this->_end-1);
+    }
+
+    T& back() {
+        return const_cast<T&>(
+            const_cast<const SafePtr&>(*this).back()
+        );
+    }
+
+    // Range over the elements of a SafePtr that is validated only once, when
+    // it is created by checked(). Iterating it and indexing it never touch
+    // the debug registry, so hot loops run at the speed of raw pointers.
+    template<typename U>
+    class CheckedRange
+    {
+    public:
+        U* begin() const {
+            return _begin;
+        }
+
+        U* end() const {
+            return _end;
+        }
+
+        U* data() const {
+            return _begin;
+        }
+
+        size_t size() const {
+            return _end - _begin;
+        }
+
+        bool empty() const {
+            return _begin == _end;
+        }
+
+        U& operator[](const size_t index) const {
+            return *(_begin + index);
+        }
+
+        U& at(const size_t index) const {
+            if (index >= size()) {
+                throw std::out_of_range(
+                    "tried to access CheckedRange element out of range"
+                );
+            }
+            return *(_begin + index);
+        }
+
+        // Validates again that the memory was not freed since the range was
+        // created. Meant to be called once after a loop; it does nothing
+        // when SAFE_PTR_DEBUG is not defined.
+        void check() const noexcept(!SAFE_PTR_TEST_BOOL) {
+            #if SAFE_PTR_DEBUG_BOOL
+                _check_for_use_after_free(_memory_id);
+            #endif
+        }
+
+    #if SAFE_PTR_DEBUG_BOOL
+        // Like subviews, ranges hold a reference to the record of the
+        // memory, so check() still works after the SafePtr that created
+        // the range is destroyed.
+        CheckedRange(const CheckedRange& other)
+            : _begin(other._begin), _end(other._end),
+              _memory_id(other._memory_id)
+        {
+            _acquire_record(_memory_id);
+        }
+
+        CheckedRange(CheckedRange&& other) noexcept
+            : _begin(other._begin), _end(other._end),
+              _memory_id(other._memory_id)
+        {
+            other._memory_id = 0;
+        }
+
+        CheckedRange& operator=(const CheckedRange& other) {
+            _acquire_record(other._memory_id);
+            _release_record(_memory_id);
+            _begin = other._begin;
+            _end = other._end;
+            _memory_id = other._memory_id;
+            return *this;
+        }
+
+        CheckedRange& operator=(CheckedRange&& other)
+            noexcept(!SAFE_PTR_TEST_BOOL)
+        {
+            if (this != &other) {
+                _release_record(_memory_id);
+                _begin = other._begin;
+                _end = other._end;
+                _memory_id = other._memory_id;
+                other._memory_id = 0;
+            }
+            return *this;
+        }
+
+        ~CheckedRange() noexcept(!SAFE_PTR_TEST_BOOL) {
+            _release_record(_memory_id);
+        }
+    #endif
+
+    private:
+        friend class SafePtr;
+
+        CheckedRange(const SafePtr* const owner, U* const begin, U* const end)
+            : _begin(begin), _end(end)
+        {
+            #if SAFE_PTR_DEBUG_BOOL
+                _memory_id = owner->_get_record_id();
+                _acquire_record(_memory_id);
+            #else
+                (void)owner;
+            #endif
+        }
+
+        U* _begin;
+        U* _end;
+        #if SAFE_PTR_DEBUG_BOOL
+            // memory id of the SafePtr the range was created from, 0 once
+            // the range was moved from
+            size_t _memory_id;
+        #endif
+    };
+
+    CheckedRange<const T> checked() const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return CheckedRange<const T>(this, _begin, _end);
+    }
+
+    CheckedRange<T> checked() {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        return CheckedRange<T>(this, _begin, _end);
+    }
+
+    CheckedRange<const T>
+    checked(const size_t offset, const size_t count) const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        if (offset > size() || count > size() - offset) {
+            throw std::out_of_range(
+                "tried to create a CheckedRange out of the SafePtr range"
+            );
+        }
+        return CheckedRange<const T>(
+            this, _begin + offset, _begin + offset + count
+        );
+    }
+
+    CheckedRange<T> checked(const size_t offset, const size_t count) {
+        const CheckedRange<const T> range =
+            const_cast<const SafePtr&>(*this).checked(offset, count);
+        return CheckedRange<T>(
+            this, const_cast<T*>(range.begin()), const_cast<T*>(range.end())
+        );
+    }
+
+    void fill(const T& value) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        if (std::is_trivially_copyable<T>::value) {
+            _fill_bytes_of(_begin, _end, value);
+        } else {
+            std::fill(_begin, _end, value);
+        }
+    }
+
+    // Like fill(), but the elements are assigned by the threads of
+    // `first_touch`.
+    void fill(const T& value, const FirstTouch& first_touch) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        _first_touch(
+            first_touch,
+            [&value](T* const first, T* const last) {
+                if (std::is_trivially_copyable<T>::value) {
+                    _fill_bytes_of(first, last, value);
+                } else {
+                    std::fill(first, last, value);
+                }
+            },
+            [](T*, T*) {}
+        );
+    }
+
+    // Prints every element to std::cout.
+    void
+    print_all(const char* const variable_name = "SafePtr::print_all") const {
+        print(std::cout, PrintFormat::all(), variable_name);
+    }
+
+    // Prints the first 13 and the last 12 elements to std::cout, or every
+    // element if there are at most 26.
+    void print(const char* const variable_name = "SafePtr::print") const {
+        print(std::cout, PrintFormat(), variable_name);
+    }
+
+    // Formats the elements into a single buffer, independently of the flags
+    // of `out`, and writes it with one call. Prints of SafePtrs do not
+    // interleave with each other, even from different threads.
+    void print(
+        std::ostream& out,
+        const PrintFormat& format,
+        const char* const variable_name = "SafePtr::print"
+    ) const {
+        const std::string text = _format(format, variable_name);
+        std::lock_guard<std::mutex> lock(_get_print_mutex());
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+#if SAFE_PTR_POSIX_BOOL
+    // The same as print(out, ...), but writes to a file descriptor.
+    void print(
+        const int fd,
+        const PrintFormat& format,
+        const char* const variable_name = "SafePtr::print"
+    ) const {
+        const std::string text = _format(format, variable_name);
+        iovec buffer;
+        buffer.iov_base = const_cast<char*>(text.data());
+        buffer.iov_len = text.size();
+        std::lock_guard<std::mutex> lock(_get_print_mutex());
+        _write_buffers(fd, &buffer, 1);
+    }
+#endif
+
+private:
+    template<typename, size_t, typename>
+    friend class SafePtr;
+
+    template<typename...>
+    friend class SafeSoA;
+
+    // Returns a range over `count` elements of type U that start `offset`
+    // bytes after the first element, e.g. a column of a SafeSoA.
+    template<typename U>
+    CheckedRange<U> _checked_as(const size_t offset, const size_t count) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        U* const begin = reinterpret_cast<U*>(
+            reinterpret_cast<char*>(_begin) + offset
+        );
+        return CheckedRange<U>(this, begin, begin + count);
+    }
+
+    template<typename U>
+    CheckedRange<const U>
+    _checked_as(const size_t offset, const size_t count) const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        const U* const begin = reinterpret_cast<const U*>(
+            reinterpret_cast<const char*>(_begin) + offset
+        );
+        return CheckedRange<const U>(this, begin, begin + count);
+    }
+
+    std::string
+    _format(const PrintFormat& format, const char* const variable_name) const {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_for_use_after_free();
+        #endif
+        const size_t size = _end - _begin;
+        const bool is_lines = format.layout == PrintLayout::lines;
+        const char* const separator = is_lines ? ",\n" :
+            format.layout == PrintLayout::compact ? ", " : ",";
+        const bool is_elided = size > format.head
+            && size - format.head > format.tail
+            && size - format.head - format.tail > 1;
+
+        std::string text;
+        text.reserve((is_elided ? format.head + format.tail : size) * 16 + 64);
+        if (format.layout != PrintLayout::csv) {
+            text += variable_name;
+            text += is_lines ? ": {\n" : ": {";
+        }
+        std::ostringstream stream;
+        const char* next_separator = "";
+        const auto append = [&](const size_t first, const size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                text += next_separator;
+                next_separator = separator;
+                if (is_lines) {
+                    text += "    ";
+                    _append_value(text, i, stream);
+                    text += ": ";
+                }
+                _append_value(text, _begin[i], stream);
+            }
+        };
+        if (is_elided) {
+            append(0, format.head);
+            text += next_separator;
+            text += is_lines ? "    ..." : "...";
+            next_separator = is_lines ? "\n" : separator;
+            append(size - format.tail, size);
+        } else {
+            append(0, size);
+        }
+        if (is_lines && *next_separator != '\0') {
+            text += '\n';
+        }
+        text += format.layout == PrintLayout::csv ? "\n" : "}\n";
+        return text;
+    }
+
+    struct _Uninitialized {};
+
+    SafePtr(_Uninitialized, const size_t size) {
+        _allocate(size);
+    }
+
+    // Owns no storage yet, but has a record for storage that is about to be
+    // reallocated, if the storage being reallocated has one.
+    struct _Reallocated {};
+
+    SafePtr(_Reallocated, const size_t size, const bool has_record)
+        : _begin(nullptr), _end(nullptr)
+    {
+        #if SAFE_PTR_DEBUG_BOOL
+            _memory_id = has_record ?
+                _new_record(false, size) : _UNSAMPLED_MEMORY_ID;
+        #else
+            (void)size;
+            (void)has_record;
+        #endif
+    }
+
+#if SAFE_PTR_POSIX_BOOL
+    struct _MappedFile {};
+
+    SafePtr(_MappedFile, const char* const path, const MapMode mode) {
+        #if SAFE_PTR_INLINE_HEADER_BOOL
+            constexpr size_t prefix_bytes = _HEADER_SIZE;
+        #else
+            constexpr size_t prefix_bytes = 0;
+        #endif
+        size_t bytes = 0;
+        _begin = static_cast<T*>(_map_file_storage(
+            path, mode, prefix_bytes, sizeof(T), Alignment, bytes
+        ));
+        _end = _begin + bytes / sizeof(T);
+        #if SAFE_PTR_INLINE_HEADER_BOOL
+            _Record* const record = new (
+                reinterpret_cast<char*>(_begin) - _HEADER_SIZE
+            ) _Record;
+            try {
+                _init_record(*record, false, _end - _begin);
+            } catch (...) {
+                Alloc::deallocate(
+                    record, _HEADER_SIZE + bytes, _HEADER_ALIGNMENT
+                );
+                throw;
+            }
+            _memory_id = static_cast<size_t>(
+                reinterpret_cast<std::uintptr_t>(record)
+            );
+        #elif SAFE_PTR_DEBUG_BOOL
+            try {
+                _memory_id = _new_record(false, _end - _begin);
+            } catch (...) {
+                _deallocate_storage(_begin, bytes);
+                throw;
+            }
+        #endif
+        _count_allocation((_end - _begin) * sizeof(T));
+    }
+#endif
+
+    T* _begin; // points to the first element
+    T* _end;   // points to the byte after the last byte of the last element
+
+    // C++11-compatible replacement for std::void_t (which is C++17)
+    template<typename...>
+    struct _sp_void { using type = void; };
+    template<typename... Ts>
+    using _sp_void_t = typename _sp_void<Ts...>::type;
+
+    // Detects whether subtracting the iterators to get the size is valid.
+    template<typename It, typename = void>
+    struct _sp_has_subtraction : std::false_type {};
+
+    template<typename It>
+    struct _sp_has_subtraction<
+        It,
+        _sp_void_t<decltype(std::declval<It>() - std::declval<It>())>
+    > : std::true_type {};
+
+    // Whether the range can be read more than once.
+    template<typename InputIt>
+    using _sp_is_multi_pass = std::is_convertible<
+        typename std::iterator_traits<InputIt>::iterator_category,
+        std::forward_iterator_tag
+    >;
+
+    // Allocates memory by subtracting the iterators to get the size (faster).
+    template<typename InputIt>
+    void _construct_from_range(
+        InputIt first, InputIt last, size_t, std::true_type
+    ) {
+        const size_t n = static_cast<size_t>(last - first);
+        _construct_copy(first, last, n);
+    }
+
+    template<typename InputIt>
+    void _construct_from_range(
+        InputIt first, InputIt last, const size_t size_hint, std::false_type
+    ) {
+        _construct_from_unsized_range(
+            first, last, size_hint, _sp_is_multi_pass<InputIt>{}
+        );
+    }
+
+    // Allocates memory by iterating along the range to count size (slower).
+    template<typename InputIt>
+    void _construct_from_unsized_range(
+        InputIt first, InputIt last, size_t, std::true_type
+    ) {
+        size_t n = 0;
+        for (InputIt it = first; it != last; ++it) {
+            ++n;
+        }
+        _construct_copy(first, last, n);
+    }
+
+    template<typename InputIt>
+    void _construct_from_unsized_range(
+        InputIt first, InputIt last, const size_t size_hint, std::false_type
+    ) {
+        _construct_from_single_pass(first, last, size_hint);
+    }
+
+    // Reads a range that can only be read once into storage that doubles
+    // when it is full, which is then taken as is if it is exactly full or
+    // shrunk to the number of elements.
+    template<typename InputIt>
+    void _construct_from_single_pass(
+        InputIt first, InputIt last, const size_t size_hint
+    ) {
+        SafePtr staging(_Uninitialized{}, size_hint);
+        T* it = staging._begin;
+        try {
+            for (; first != last; ++first, ++it) {
+                if (it == staging._end) {
+                    const size_t size = it - staging._begin;
+                    staging._grow_staging();
+                    it = staging._begin + size;
+                }
+                ::new (static_cast<void*>(it)) T(*first);
+            }
+            staging._shrink_staging(it - staging._begin);
+        } catch (...) {
+            _destroy(staging._begin, it);
+            staging._deallocate_uninitialized();
+            throw;
+        }
+        _take(staging);
+    }
+
+    // Doubles the storage of a staging SafePtr, which must be full.
+    void _grow_staging() {
+        const size_t size = _end - _begin;
+        if (size > std::numeric_limits<size_t>::max() / 2 / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        _resize_staging(size, size < 8 ? 16 : size * 2);
+    }
+
+    // Gives a staging SafePtr the exact storage for its first `size`
+    // elements.
+    void _shrink_staging(const size_t size) {
+        if (size != static_cast<size_t>(_end - _begin)) {
+            _resize_staging(size, size);
+        }
+    }
+
+    // Moves the first `size` elements to storage for `capacity` elements.
+    // The old storage belongs to no one else, so it is resized by the
+    // allocator when possible. If moving an element throws, nothing changes.
+    void _resize_staging(const size_t size, const size_t capacity) {
+        constexpr bool can_reallocate =
+            is_trivially_relocatable<T>::value &&
+            std::is_trivially_destructible<T>::value &&
+            !SAFE_PTR_INLINE_HEADER_BOOL;
+        void* const storage = !can_reallocate ? nullptr : _reallocate_storage(
+            _begin, (_end - _begin) * sizeof(T), capacity * sizeof(T),
+            _sp_has_reallocate<Alloc>{}
+        );
+        if (storage != nullptr) {
+            #if SAFE_PTR_DEBUG_BOOL
+                if (_has_record()) {
+                    _Record& record = _find_record();
+                    if (record.site != nullptr) {
+                        record.site->live_bytes.fetch_add(
+                            (capacity - record.size) * sizeof(T),
+                            std::memory_order_relaxed
+                        ); // wraps around when shrinking
+                    }
+                    record.size = capacity;
+                }
+            #endif
+            _count_free((_end - _begin) * sizeof(T));
+            _count_allocation(capacity * sizeof(T));
+            _begin = static_cast<T*>(storage);
+            _end = _begin + capacity;
+            return;
+        }
+        SafePtr resized(_Uninitialized{}, capacity);
+        try {
+            _relocate(
+                _begin, _begin + size, resized._begin,
+                is_trivially_relocatable<T>{}
+            );
+        } catch (...) {
+            resized._deallocate_uninitialized();
+            throw;
+        }
+        _deallocate_uninitialized();
+        _take(resized);
+    }
+
+    // Takes the storage and record of `other`, which becomes an empty view.
+    void _take(SafePtr& other) {
+        _begin = other._begin;
+        _end = other._end;
+        other._begin = nullptr;
+        other._end = nullptr;
+        #if SAFE_PTR_DEBUG_BOOL
+            _memory_id = other._memory_id;
+            other._memory_id = 0;
+        #endif
+    }
+
+    // Allocates uninitialized storage for `size` elements and, in debug
+    // mode, the record that tracks it, unless the allocation is not sampled
+    // (see SAFE_PTR_DEBUG_SAMPLE_RATE).
+    void _allocate(const size_t size) {
+        if (size > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        #if SAFE_PTR_DEBUG_BOOL
+            const bool is_sampled = _get_is_sampled();
+        #endif
+        #if SAFE_PTR_INLINE_HEADER_BOOL
+            if (is_sampled && _IS_HEADER_INLINE) {
+                _memory_id = _new_record(false, size);
+                _begin = _get_data_after_header();
+                _end = _begin + size;
+                _count_allocation(size * sizeof(T));
+                return;
+            }
+        #endif
+        _begin = static_cast<T*>(_allocate_storage(size * sizeof(T)));
+        #if SAFE_PTR_DEBUG_BOOL
+            try {
+                _memory_id = is_sampled ?
+                    _new_record(false, size) : _UNSAMPLED_MEMORY_ID;
+            } catch (...) {
+                _deallocate_storage(_begin, size * sizeof(T));
+                throw;
+            }
+        #endif
+        _end = _begin + size;
+        _count_allocation(size * sizeof(T));
+    }
+
+    // Undoes _allocate() when constructing the elements failed.
+    void _deallocate_uninitialized() {
+        _count_free((_end - _begin) * sizeof(T));
+        const bool has_own_storage = _has_own_storage();
+        #if SAFE_PTR_DEBUG_BOOL
+            if (_has_record()) {
+                _erase_record();
+            }
+            _memory_id = 0;
+        #endif
+        if (has_own_storage) {
+            _deallocate_storage(_begin, (_end - _begin) * sizeof(T));
+        }
+        _begin = nullptr;
+        _end = nullptr;
+    }
+
+    // Destroys the elements and returns the storage. In inline header mode,
+    // the storage is only returned when the last SafePtr holding the header
+    // is destroyed (see _release_record()).
+    void _deallocate() const {
+        _destroy(_begin, _end);
+        if (_begin != nullptr) {
+            _count_free((_end - _begin) * sizeof(T));
+        }
+        if (_has_own_storage()) {
+            _deallocate_storage(_begin, (_end - _begin) * sizeof(T));
+        } else {
+            _poison_kept_storage();
+        }
+    }
+
+    // In inline header mode, freed storage stays behind its header until the
+    // last SafePtr holding the header is destroyed. In
+    // SAFE_PTR_DEBUG_QUARANTINE mode, its guards are checked right away and
+    // it is poisoned meanwhile (see _erase_record()).
+    void _poison_kept_storage() const {
+        #if SAFE_PTR_QUARANTINE_BOOL && SAFE_PTR_INLINE_HEADER_BOOL
+            if (!_is_guarded::value) {
+                return;
+            }
+            const size_t bytes = (_end - _begin) * sizeof(T);
+            unsigned char* const header =
+                reinterpret_cast<unsigned char*>(_begin) - _HEADER_SIZE;
+            const bool is_overrun = !_check_guards(
+                header, _HEADER_SIZE + bytes, _HEADER_ALIGNMENT
+            );
+            std::memset(static_cast<void*>(_begin), _POISON_BYTE, bytes);
+            if (is_overrun) {
+                SAFE_PTR_WARNING(
+                    "Memory was written out of its bounds before free() "
+                    "was called."
+                );
+            }
+        #endif
+    }
+
+    // Counts storage given to or taken back from a SafePtr in
+    // SAFE_PTR_STATS mode.
+    static void _count_allocation(const size_t bytes) {
+        #if SAFE_PTR_STATS_BOOL
+            fz::_count_allocation(_get_stats_type_index<T>(), bytes);
+        #else
+            (void)bytes;
+        #endif
+    }
+
+    static void _count_free(const size_t bytes) {
+        #if SAFE_PTR_STATS_BOOL
+            fz::_count_free(_get_stats_type_index<T>(), bytes);
+        #else
+            (void)bytes;
+        #endif
+    }
+
+    // Whether the elements are in storage of their own, rather than after
+    // an inline header that is released with the record.
+    bool _has_own_storage() const {
+        #if SAFE_PTR_INLINE_HEADER_BOOL
+            return !_IS_HEADER_INLINE || !_has_record();
+        #else
+            return true;
+        #endif
+    }
+
+    // The _construct_* methods allocate the storage and construct every
+    // element exactly once, directly in place.
+    void _construct_default(const size_t size) {
+        _allocate(size);
+        T* it = _begin;
+        try {
+            for (; it != _end; ++it) {
+                ::new (static_cast<void*>(it)) T;
+            }
+        } catch (...) {
+            _destroy(_begin, it);
+            _deallocate_uninitialized();
+            throw;
+        }
+    }
+
+    void _construct_fill(const size_t size, const T& value) {
+        _allocate(size);
+        try {
+            if (std::is_trivially_copyable<T>::value) {
+                _fill_bytes_of(_begin, _end, value);
+            } else {
+                std::uninitialized_fill(_begin, _end, value);
+            }
+        } catch (...) {
+            _deallocate_uninitialized();
+            throw;
+        }
+    }
+
+    template<typename InputIt>
+    void _construct_copy(InputIt first, InputIt last, const size_t size) {
+        _allocate(size);
+        try {
+            _copy_to_uninitialized(first, last, _is_bytes_copyable<InputIt>{});
+        } catch (...) {
+            _deallocate_uninitialized();
+            throw;
+        }
+    }
+
+    // Calls `f(first, last)` on the elements of every thread of
+    // `first_touch`, from a thread started for it. If any call throws,
+    // `undo(first, last)` is called on the ranges that were completed and the
+    // first exception is rethrown.
+    template<typename F, typename Undo>
+    void _first_touch(const FirstTouch& first_touch, F f, Undo undo) const {
+        const size_t thread_count = first_touch.thread_count();
+        const size_t size = _end - _begin;
+        std::vector<std::exception_ptr> errors(thread_count);
+        std::vector<size_t> completed_chunks(thread_count, 0);
+        auto work = [&](const size_t index, const bool is_started) {
+            try {
+                if (is_started && first_touch._on_thread_start) {
+                    first_touch._on_thread_start(index);
+                }
+                first_touch._for_each_chunk(
+                    index, _begin, size, sizeof(T),
+                    [&](const size_t first, const size_t last) {
+                        f(_begin + first, _begin + last);
+                        ++completed_chunks[index];
+                    }
+                );
+            } catch (...) {
+                errors[index] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        size_t index = 0;
+        try {
+            for (; index < thread_count; ++index) {
+                threads.push_back(std::thread(work, index, true));
+            }
+        } catch (const std::system_error&) {} // out of threads
+        for (; index < thread_count; ++index) {
+            work(index, false);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        const auto error = std::find_if(
+            errors.begin(), errors.end(),
+            [](const std::exception_ptr& e) { return e != nullptr; }
+        );
+        if (error == errors.end()) {
+            return;
+        }
+        for (size_t i = 0; i != thread_count; ++i) {
+            size_t chunks_left = completed_chunks[i];
+            first_touch._for_each_chunk(
+                i, _begin, size, sizeof(T),
+                [&](const size_t first, const size_t last) {
+                    if (chunks_left != 0) {
+                        undo(_begin + first, _begin + last);
+                        --chunks_left;
+                    }
+                }
+            );
+        }
+        std::rethrow_exception(*error);
+    }
+
+    // Writes `value` to the elements as raw bytes, whether they were
+    // constructed before or not. Only for trivially copyable types.
+    static void _fill_bytes_of(T* const first, T* const last, const T& value) {
+        const T copy(value); // `value` may be one of the elements
+        _fill_bytes(first, &copy, sizeof(T), last - first);
+    }
+
+    // Whether a range given by `InputIt` can be copied as raw bytes.
+    template<typename InputIt>
+    using _is_bytes_copyable = std::integral_constant<bool,
+        std::is_trivially_copyable<T>::value &&
+        std::is_pointer<InputIt>::value &&
+        std::is_same<
+            typename std::remove_cv<
+                typename std::remove_pointer<InputIt>::type
+            >::type,
+            T
+        >::value
+    >;
+
+    template<typename InputIt>
+    void _copy_to_uninitialized(InputIt first, InputIt last, std::true_type) {
+        _copy_bytes(_begin, first, (last - first) * sizeof(T));
+    }
+
+    template<typename InputIt>
+    void _copy_to_uninitialized(InputIt first, InputIt last, std::false_type) {
+        std::uninitialized_copy(first, last, _begin);
+    }
+
+    // Detects whether the allocator has a reallocate() method.
+    template<typename A, typename = void>
+    struct _sp_has_reallocate : std::false_type {};
+
+    template<typename A>
+    struct _sp_has_reallocate<
+        A,
+        _sp_void_t<decltype(A::reallocate(nullptr, 0, 0, 0))>
+    > : std::true_type {};
+
+    // `construct(first, last)` constructs the new elements. When it can not
+    // throw, the storage may be resized by the allocator, since the resize
+    // would not need to be undone.
+    template<typename Construct, typename IsNothrow>
+    void _resize(const size_t size, Construct construct, IsNothrow) {
+        #if SAFE_PTR_DEBUG_BOOL
+            _check_can_reuse();
+        #endif
+        const size_t old_size = _end - _begin; // size() warns if freed
+        if (size == old_size) {
+            return;
+        }
+        if (size > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        constexpr bool can_reallocate =
+            _sp_has_reallocate<Alloc>::value &&
+            is_trivially_relocatable<T>::value &&
+            std::is_trivially_destructible<T>::value &&
+            IsNothrow::value &&
+            !SAFE_PTR_INLINE_HEADER_BOOL;
+        if (_reallocate(size, construct, _sp_bool<can_reallocate>{})) {
+            return;
+        }
+
+        SafePtr resized(_Uninitialized{}, size);
+        const size_t kept = std::min(size, old_size);
+        try {
+            construct(resized._begin + kept, resized._end);
+        } catch (...) {
+            resized._deallocate_uninitialized();
+            throw;
+        }
+        try {
+            _relocate(
+                _begin, _begin + kept, resized._begin,
+                is_trivially_relocatable<T>{}
+            );
+        } catch (...) {
+            _destroy(resized._begin + kept, resized._end);
+            resized._deallocate_uninitialized();
+            throw;
+        }
+        _destroy(_begin + kept, _end);
+        _release_storage();
+        _swap(resized); // `resized` releases the old record when destroyed
+    }
+
+    template<bool B>
+    using _sp_bool = std::integral_constant<bool, B>;
+
+    template<typename Construct>
+    bool _reallocate(size_t, Construct, std::false_type) {
+        return false;
+    }
+
+    template<typename Construct>
+    bool _reallocate(const size_t size, Construct construct, std::true_type) {
+        if (_begin == nullptr) {
+            return false;
+        }
+        #if SAFE_PTR_DEBUG_BOOL
+            SafePtr resized(_Reallocated{}, size, _has_record());
+        #else
+            SafePtr resized(_Reallocated{}, size, false);
+        #endif
+        const size_t old_size = _end - _begin;
+        void* const storage = _reallocate_storage(
+            _begin, old_size * sizeof(T), size * sizeof(T),
+            _sp_has_reallocate<Alloc>{}
+        );
+        if (storage == nullptr) {
+            #if SAFE_PTR_DEBUG_BOOL
+                if (resized._has_record()) {
+                    _mark_deleted(resized._find_record());
+                }
+            #endif
+            return false;
+        }
+        resized._begin = static_cast<T*>(storage);
+        resized._end = resized._begin + size;
+        _count_free(old_size * sizeof(T));
+        _count_allocation(size * sizeof(T));
+        if (size > old_size) {
+            construct(resized._begin + old_size, resized._end);
+        }
+        #if SAFE_PTR_DEBUG_BOOL
+            if (_has_record()) {
+                _mark_deleted(_find_record());
+            }
+        #endif
+        _swap(resized);
+        return true;
+    }
+
+    static void* _reallocate_storage(
+        void* const storage, const size_t old_bytes, const size_t new_bytes,
+        std::true_type
+    ) {
+        #if SAFE_PTR_QUARANTINE_BOOL
+            if (_is_guarded::value) {
+                return nullptr; // the back guard would be lost
+            }
+        #endif
+        return Alloc::reallocate(storage, old_bytes, new_bytes, Alignment);
+    }
+
+    static void* _reallocate_storage(void*, size_t, size_t, std::false_type) {
+        return nullptr;
+    }
+
+    // Moves [first, last) to the uninitialized memory at `dest`, after
+    // which the original elements must not be destroyed. If a move throws,
+    // nothing is moved (like std::vector, elements are copied instead of
+    // moved when their move constructor may throw).
+    static void _relocate(
+        T* const first, T* const last, T* const dest, std::true_type
+    ) {
+        _copy_bytes(dest, first, (last - first) * sizeof(T));
+    }
+
+    static void _relocate(
+        T* const first, T* const last, T* const dest, std::false_type
+    ) {
+        T* out = dest;
+        try {
+            for (T* it = first; it != last; ++it, ++out) {
+                ::new (static_cast<void*>(out)) T(std::move_if_noexcept(*it));
+            }
+        } catch (...) {
+            _destroy(dest, out);
+            throw;
+        }
+        _destroy(first, last);
+    }
+
+    // Marks the memory as freed and returns its storage, without destroying
+    // the elements (they were moved).
+    void _release_storage() {
+        #if SAFE_PTR_DEBUG_BOOL
+            if (_has_record()) {
+                _mark_deleted(_find_record());
+            }
+        #endif
+        if (_begin == nullptr) {
+            return;
+        }
+        _count_free((_end - _begin) * sizeof(T));
+        if (_has_own_storage()) {
+            _deallocate_storage(_begin, (_end - _begin) * sizeof(T));
+        } else {
+            _poison_kept_storage();
+        }
+    }
+
+    void _swap(SafePtr& other) {
+        std::swap(_begin, other._begin);
+        std::swap(_end, other._end);
+        #if SAFE_PTR_DEBUG_BOOL
+            std::swap(_memory_id, other._memory_id);
+        #endif
+    }
+
+    static void* _allocate_storage(
+        const size_t bytes, const size_t alignment = Alignment
+    ) {
+        #if SAFE_PTR_QUARANTINE_BOOL
+            if (_is_guarded::value) {
+                return _allocate_guarded(bytes, alignment);
+            }
+        #endif
+        return Alloc::allocate(bytes, alignment);
+    }
+
+    // `bytes` and `alignment` must be the same as the ones given to
+    // _allocate_storage().
+    static void _deallocate_storage(
+        void* const storage, const size_t bytes,
+        const size_t alignment = Alignment
+    ) {
+        #if SAFE_PTR_QUARANTINE_BOOL
+            if (_is_guarded::value && storage != nullptr) {
+                _deallocate_guarded(storage, bytes, alignment);
+                return;
+            }
+        #endif
+        Alloc::deallocate(storage, bytes, alignment);
+    }
+
+    #if SAFE_PTR_QUARANTINE_BOOL
+        // Storage of these allocators is guarded and quarantined. Others may
+        // release it on their own (ArenaAllocator) or hand out storage that
+        // SafePtr does not lay out (map_file()).
+        using _is_guarded = std::integral_constant<bool,
+            std::is_same<Alloc, DefaultAllocator>::value ||
+            std::is_same<Alloc, PoolAllocator>::value
+        >;
+
+        static void* _allocate_guarded(
+            const size_t bytes, const size_t alignment
+        ) {
+            const size_t front_bytes = _get_front_guard_bytes(alignment);
+            const size_t guard_bytes = front_bytes + SAFE_PTR_DEBUG_GUARD_BYTES;
+            if (bytes > std::numeric_limits<size_t>::max() - guard_bytes) {
+                throw std::bad_array_new_length();
+            }
+            unsigned char* const storage = static_cast<unsigned char*>(
+                Alloc::allocate(bytes + guard_bytes, alignment)
+            );
+            std::memset(storage, _GUARD_BYTE, front_bytes);
+            std::memset(
+                storage + front_bytes + bytes, _GUARD_BYTE,
+                SAFE_PTR_DEBUG_GUARD_BYTES
+            );
+            return storage + front_bytes;
+        }
+
+        // Returns whether the guards around the `bytes` bytes at `elements`
+        // are intact, and refills them if not, so each overrun is reported
+        // once.
+        static bool _check_guards(
+            unsigned char* const elements, const size_t bytes,
+            const size_t alignment
+        ) {
+            const size_t front_bytes = _get_front_guard_bytes(alignment);
+            unsigned char* const front = elements - front_bytes;
+            unsigned char* const back = elements + bytes;
+            if (_is_filled_with(front, front_bytes, _GUARD_BYTE) &&
+                _is_filled_with(back, SAFE_PTR_DEBUG_GUARD_BYTES, _GUARD_BYTE)
+            ) {
+                return true;
+            }
+            std::memset(front, _GUARD_BYTE, front_bytes);
+            std::memset(back, _GUARD_BYTE, SAFE_PTR_DEBUG_GUARD_BYTES);
+            return false;
+        }
+
+        // Checks the guards, poisons the storage and puts it in the
+        // quarantine, which may release older storage.
+        static void _deallocate_guarded(
+            void* const elements, const size_t bytes, const size_t alignment
+        ) {
+            const size_t front_bytes = _get_front_guard_bytes(alignment);
+            unsigned char* const storage =
+                static_cast<unsigned char*>(elements) - front_bytes;
+            const size_t total_bytes =
+                front_bytes + bytes + SAFE_PTR_DEBUG_GUARD_BYTES;
+            const bool is_overrun = !_check_guards(
+                static_cast<unsigned char*>(elements), bytes, alignment
+            );
+            size_t written_count = 0;
+            if (total_bytes > SAFE_PTR_DEBUG_QUARANTINE_BYTES) {
+                Alloc::deallocate(storage, total_bytes, alignment);
+            } else {
+                std::memset(storage, _POISON_BYTE, total_bytes);
+                written_count = _quarantine(_QuarantinedBlock{
+                    storage, total_bytes, alignment, &Alloc::deallocate
+                });
+            }
+            if (is_overrun) {
+                SAFE_PTR_WARNING(
+                    "Memory was written out of its bounds before free() "
+                    "was called."
+                );
+            }
+            if (written_count != 0) {
+                SAFE_PTR_WARNING(
+                    "Memory was written after free() was called (found "
+                    "when it left the quarantine)."
+                );
+            }
+        }
+    #endif
+
+    static void _destroy(T* const first, T* last) {
+        while (last != first) {
+            (--last)->~T();
+        }
+    }
+
+    #if SAFE_PTR_DEBUG_BOOL
+        // Debug registry
+        //
+        // Every SafePtr that is not a view made by make_view() carries a
+        // memory id that names a _Record in the registry, unless its
+        // allocation was not sampled (see SAFE_PTR_DEBUG_SAMPLE_RATE). The
+        // registry is split into _SHARD_COUNT shards, each guarded by its own
+        // mutex, so threads working on different allocations almost never
+        // contend for the same lock.
+        //
+        // Consistency rules:
+        // - A shard mutex is only held while a slot is taken or given back,
+        //   and never while another shard mutex is held. Records are looked
+        //   up without it.
+        // - Slots never move, so a record stays valid while the caller holds
+        //   a reference to it. Every SafePtr holding the id is such a
+        //   reference, so ref_count and is_deleted can be updated with
+        //   atomics outside of the lock.
+        // - A record is erased only by the thread that drops ref_count to 0.
+        //   At that point no other SafePtr holds the id, so nobody else can
+        //   be reading the record.
+        // - free() flips is_deleted with a compare-and-swap, so among several
+        //   concurrent free() calls on the same memory exactly one succeeds
+        //   and the others throw.
+        // - Moves only increment the ref_count of a record the source still
+        //   holds, so a concurrent move and free() of the same memory can
+        //   only race on is_deleted, which is atomic.
+        //
+        // If SAFE_PTR_DEBUG_INLINE_HEADER is defined, the registry is not
+        // used. Each record is instead placed in a header directly in front
+        // of the elements and the memory id is the address of that header,
+        // so finding a record is a pointer dereference instead of a locked
+        // hash lookup. The same rules apply, with "erased" meaning that the
+        // header and the storage behind it are returned to the system.
+        // Because of that, in this mode the storage of freed memory is kept
+        // until the last SafePtr that points to it is destroyed.
+        //
+        // Views of SafePtr<const T> (see subview() const) hold records of
+        // memory of SafePtr<T>, so both use the records and the registry of
+        // SafePtr<T>.
+        using _Record = _MemoryRecord;
+        using _Registry = SafePtr<
+            typename std::remove_const<T>::type, Alignment, Alloc
+        >;
+
+        // Sets up a new record with a ref_count of 1. Records that are not
+        // deleted are counted as live at the current allocation site.
+        static void _init_record(
+            _Record& record, const bool is_deleted, const size_t size
+        ) {
+            record.ref_count.store(1, std::memory_order_relaxed);
+            record.is_deleted.store(is_deleted, std::memory_order_relaxed);
+            record.size = size;
+            record.site = nullptr;
+            record.is_live.store(!is_deleted, std::memory_order_relaxed);
+            #if SAFE_PTR_BACKTRACE_BOOL
+                record.backtrace = nullptr;
+            #endif
+            if (is_deleted) {
+                return;
+            }
+            record.site = _get_site_stats(_get_type_name<T>());
+            record.site->live_count.fetch_add(1, std::memory_order_relaxed);
+            record.site->live_bytes.fetch_add(
+                size * sizeof(T), std::memory_order_relaxed
+            );
+            #if SAFE_PTR_BACKTRACE_BOOL
+                record.backtrace = _sample_backtrace();
+            #endif
+        }
+
+        // Stops counting the memory of `record` as live, when it is deleted
+        // or leaked. Only the first call has an effect.
+        static void _retire_record(_Record& record, const bool is_leaked) {
+            if (record.site == nullptr ||
+                !record.is_live.exchange(false, std::memory_order_relaxed)
+            ) {
+                return;
+            }
+            const size_t bytes = record.size * sizeof(T);
+            record.site->live_count.fetch_sub(1, std::memory_order_relaxed);
+            record.site->live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            if (is_leaked) {
+                record.site->leaked_count.fetch_add(
+                    1, std::memory_order_relaxed
+                );
+                record.site->leaked_bytes.fetch_add(
+                    bytes, std::memory_order_relaxed
+                );
+            }
+        }
+
+        static void _mark_deleted(_Record& record) {
+            record.is_deleted.store(true, std::memory_order_release);
+            _retire_record(record, false);
+        }
+
+        // Releases what a record owns besides its memory, before it is
+        // erased.
+        static void _destroy_record(_Record& record) {
+            _retire_record(record, false);
+            #if SAFE_PTR_BACKTRACE_BOOL
+                delete record.backtrace;
+            #endif
+        }
+
+        // The site the memory was allocated at, or an unknown site.
+        const AllocationSite& _get_allocation_site() const {
+            if (!_has_record()) {
+                return _get_unknown_site();
+            }
+            const _SiteStats* const site = _find_record().site;
+            return site != nullptr ? site->site : _get_unknown_site();
+        }
+
+        size_t _memory_id; // 0 is for if the ptr is a view
+
+        // Subviews hold the memory id of the memory they point into with
+        // this bit set, and a reference to its record, so they are checked
+        // for use after free. The memory is then only erased when the last
+        // subview is destroyed, which may happen after the SafePtr that
+        // owned it. Headers are aligned, so the low bit of their address is
+        // free, and generations stop short of the high bit of registry ids.
+    #if SAFE_PTR_INLINE_HEADER_BOOL
+        static constexpr size_t _SUBVIEW_BIT = 1;
+    #else
+        static constexpr size_t _SUBVIEW_BIT =
+            size_t(1) << (std::numeric_limits<size_t>::digits - 1);
+    #endif
+
+        // memory id of memory that is owned but not tracked, because its
+        // allocation was not sampled (see SAFE_PTR_DEBUG_SAMPLE_RATE)
+        static constexpr size_t _UNSAMPLED_MEMORY_ID =
+            std::numeric_limits<size_t>::max() & ~_SUBVIEW_BIT;
+
+    #if SAFE_PTR_INLINE_HEADER_BOOL
+        // Whether records are placed in front of the elements. Storage that
+        // is released without free() (e.g. by Arena::reset()) would take the
+        // record with it while SafePtrs still hold it, so the records of
+        // such allocators are allocated on their own instead.
+        static constexpr bool _IS_HEADER_INLINE = Alloc::requires_free;
+
+        // alignment of the storage, so both the header and the elements are
+        // aligned
+        static constexpr size_t _HEADER_ALIGNMENT =
+            Alignment > alignof(_Record) ? Alignment : alignof(_Record);
+
+        // size of the header, rounded up so the elements stay aligned
+        static constexpr size_t _HEADER_SIZE =
+            (sizeof(_Record) + Alignment - 1) / Alignment * Alignment;
+
+        // Allocates a header followed by storage for `size` elements and
+        // returns the address of the header as the memory id. If the header
+        // is not inline, only the header is allocated.
+        static size_t _new_record(const bool is_deleted, const size_t size=0) {
+            if (!_IS_HEADER_INLINE) {
+                std::unique_ptr<_Record> record(new _Record);
+                _init_record(*record, is_deleted, size);
+                return static_cast<size_t>(
+                    reinterpret_cast<std::uintptr_t>(record.release())
+                );
+            }
+            constexpr size_t max_bytes = std::numeric_limits<size_t>::max();
+            if (size > (max_bytes - _HEADER_SIZE) / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            void* const storage = _allocate_storage(
+                _HEADER_SIZE + size * sizeof(T), _HEADER_ALIGNMENT
+            );
+            _Record* const record = new (storage) _Record;
+            _init_record(*record, is_deleted, size);
+            return static_cast<size_t>(
+                reinterpret_cast<std::uintptr_t>(record)
+            );
+        }
+
+        static _Record& _find_record(const size_t memory_id) {
+            return *reinterpret_cast<_Record*>(
+                static_cast<std::uintptr_t>(memory_id)
+            );
+        }
+
+        T* _get_data_after_header() const {
+            return reinterpret_cast<T*>(
+                reinterpret_cast<char*>(&_find_record()) + _HEADER_SIZE
+            );
+        }
+
+        static void _erase_record(const size_t memory_id) {
+            _Record& record = _find_record(memory_id);
+            if (!_IS_HEADER_INLINE) {
+                _destroy_record(record);
+                delete &record;
+                return;
+            }
+            #if SAFE_PTR_QUARANTINE_BOOL
+                // freed elements were poisoned by _poison_kept_storage()
+                const bool is_written = _is_guarded::value &&
+                    record.is_deleted.load(std::memory_order_relaxed) &&
+                    !_is_filled_with(
+                        reinterpret_cast<unsigned char*>(&record) +
+                            _HEADER_SIZE,
+                        record.size * sizeof(T), _POISON_BYTE
+                    );
+            #endif
+            _destroy_record(record);
+            const size_t bytes = _HEADER_SIZE + record.size * sizeof(T);
+            record.~_Record();
+            _deallocate_storage(&record, bytes, _HEADER_ALIGNMENT);
+            #if SAFE_PTR_QUARANTINE_BOOL
+                if (is_written) {
+                    SAFE_PTR_WARNING(
+                        "Memory was written after free() was called."
+                    );
+                }
+            #endif
+        }
+    #else
+        // The registry is a generational slot map. The low _INDEX_BITS bits
+        // of a memory id are the index of a slot and the others the
+        // generation of that slot when the id was handed out. The low
+        // _SHARD_BITS bits of the index pick the shard and the rest the slot
+        // in it. Erasing a record bumps the generation of its slot and puts
+        // the slot on the free list of its shard, so making and finding an
+        // id takes constant time however many ids were handed out before,
+        // and an id whose record was erased no longer matches its slot.
+        //
+        // The slots of a shard are kept in chunks that double in size, so
+        // they never move once made and are found without taking the lock,
+        // which only guards the free list and the making of new slots.
+        static constexpr size_t _SHARD_BITS = 6;
+        static constexpr size_t _SHARD_COUNT = size_t(1) << _SHARD_BITS;
+        static constexpr size_t _INDEX_BITS =
+            std::numeric_limits<size_t>::digits >= 64 ? 32 : 20;
+        static constexpr size_t _INDEX_MASK = (size_t(1) << _INDEX_BITS) - 1;
+        static constexpr size_t _MAX_SLOT_COUNT =
+            size_t(1) << (_INDEX_BITS - _SHARD_BITS);
+
+        // generations wrap around before reaching this, so that no id is
+        // 0 or _UNSAMPLED_MEMORY_ID, or has _SUBVIEW_BIT set
+        static constexpr size_t _MAX_GENERATION =
+            std::numeric_limits<size_t>::max() >> (_INDEX_BITS + 1);
+
+        // the first chunk has 2^_FIRST_CHUNK_BITS slots
+        static constexpr size_t _FIRST_CHUNK_BITS = 6;
+        static constexpr size_t _CHUNK_COUNT =
+            _INDEX_BITS - _SHARD_BITS - _FIRST_CHUNK_BITS + 1;
+
+        struct _Slot {
+            std::atomic<size_t> generation{1};
+            _Record record;
+        };
+
+        // Zero initialized by _get_shards(). Chunks are never deleted.
+        struct alignas(64) _Shard {
+            std::mutex mtx;
+            std::atomic<_Slot*> chunks[_CHUNK_COUNT];
+            size_t slot_count; // number of slots made so far
+            std::vector<size_t> free_slots; // never needs to grow on push
+        };
+
+        struct _Shards {
+            _Shard shards[_SHARD_COUNT];
+        };
+
+        // The shards are made on first use and never destroyed, like the
+        // site registry, so SafePtrs with static storage duration can still
+        // find and erase their records at exit.
+        static _Shard* _get_shards() {
+            static typename std::aligned_storage<
+                sizeof(_Shards), alignof(_Shards)
+            >::type storage;
+            static _Shards* const shards = new (&storage) _Shards();
+            return shards->shards;
+        }
+
+        // Returns the chunk that holds the slot at `position`, which is the
+        // index of the slot plus the size of the first chunk.
+        static size_t _get_chunk(const size_t position) {
+            #if defined(__GNUC__) || defined(__clang__)
+                const size_t width =
+                    std::numeric_limits<unsigned long long>::digits -
+                    __builtin_clzll(position);
+            #else
+                size_t width = 0;
+                for (size_t bits = position; bits != 0; bits >>= 1) {
+                    ++width;
+                }
+            #endif
+            return width - 1 - _FIRST_CHUNK_BITS;
+        }
+
+        // Returns the chunk of `shard` that holds slot `slot`, or nullptr if
+        // it was not made yet.
+        static _Slot* _get_chunk_of(const _Shard& shard, const size_t slot) {
+            const size_t position = slot + (size_t(1) << _FIRST_CHUNK_BITS);
+            return shard.chunks[_get_chunk(position)].load(
+                std::memory_order_acquire
+            );
+        }
+
+        // Returns slot `slot` of `shard`, whose chunk must have been made.
+        static _Slot& _get_slot(const _Shard& shard, const size_t slot) {
+            const size_t position = slot + (size_t(1) << _FIRST_CHUNK_BITS);
+            const size_t chunk = _get_chunk(position);
+            const size_t first = size_t(1) << (chunk + _FIRST_CHUNK_BITS);
+            return shard.chunks[chunk].load(std::memory_order_acquire)[
+                position - first
+            ];
+        }
+
+        // Makes a new slot in `shard`, whose lock must be held, and returns
+        // its index in the shard.
+        static size_t _make_slot(_Shard& shard) {
+            const size_t slot = shard.slot_count;
+            if (slot == _MAX_SLOT_COUNT) {
+                throw std::length_error(
+                    "Ran out of memory ids for live allocations."
+                );
+            }
+            const size_t position = slot + (size_t(1) << _FIRST_CHUNK_BITS);
+            if ((position & (position - 1)) == 0) {
+                // the first slot of a chunk, which holds `position` slots,
+                // so the free list doubles like the slots. Reserved first,
+                // so erasing a record never allocates.
+                shard.free_slots.reserve(slot + position);
+                shard.chunks[_get_chunk(position)].store(
+                    new _Slot[position], std::memory_order_release
+                );
+            }
+            shard.slot_count = slot + 1;
+            return slot;
+        }
+
+        // Creates a record with a ref_count of 1 for `size` elements and
+        // returns its memory id. Each thread takes the shards in turn.
+        static size_t _new_record(const bool is_deleted, const size_t size=0) {
+            static thread_local size_t next_shard =
+                std::hash<std::thread::id>()(std::this_thread::get_id());
+            const size_t shard_index = next_shard++ & (_SHARD_COUNT-1);
+            typename _Registry::_Shard& shard =
+                _Registry::_get_shards()[shard_index];
+            size_t slot;
+            {
+                std::lock_guard<std::mutex> lock(shard.mtx);
+                if (shard.free_slots.empty()) {
+                    slot = _Registry::_make_slot(shard);
+                } else {
+                    slot = shard.free_slots.back();
+                    shard.free_slots.pop_back();
+                }
+            }
+            typename _Registry::_Slot& entry =
+                _Registry::_get_slot(shard, slot);
+            const size_t memory_id =
+                (entry.generation.load(std::memory_order_relaxed) <<
+                    _INDEX_BITS) |
+                (slot << _SHARD_BITS) |
+                shard_index;
+            try {
+                _init_record(entry.record, is_deleted, size);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(shard.mtx);
+                shard.free_slots.push_back(slot);
+                throw;
+            }
+            return memory_id;
+        }
+
+        static _Slot& _find_slot(const size_t memory_id) {
+            const _Shard& shard =
+                _get_shards()[memory_id & (_SHARD_COUNT-1)];
+            const size_t slot = (memory_id & _INDEX_MASK) >> _SHARD_BITS;
+            if (_get_chunk_of(shard, slot) == nullptr ||
+                _get_slot(shard, slot).generation.load(
+                    std::memory_order_relaxed
+                ) != memory_id >> _INDEX_BITS
+            ) {
+                throw std::out_of_range(
+                    "The memory id does not name any live memory."
+                );
+            }
+            return _get_slot(shard, slot);
+        }
+
+        static _Record& _find_record(const size_t memory_id) {
+            return _Registry::_find_slot(memory_id).record;
+        }
+
+        static void _erase_record(const size_t memory_id) {
+            typename _Registry::_Slot& entry =
+                _Registry::_find_slot(memory_id);
+            _destroy_record(entry.record);
+            typename _Registry::_Shard& shard =
+                _Registry::_get_shards()[memory_id & (_SHARD_COUNT-1)];
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            const size_t generation =
+                entry.generation.load(std::memory_order_relaxed) + 1;
+            entry.generation.store(
+                generation == _MAX_GENERATION ? 1 : generation,
+                std::memory_order_relaxed
+            );
+            shard.free_slots.push_back(
+                (memory_id & _INDEX_MASK) >> _SHARD_BITS
+            );
+        }
+    #endif
+
+        static void _acquire_record(const size_t memory_id) {
+            if (!_has_record(memory_id)) {
+                return;
+            }
+            _find_record(memory_id).ref_count.fetch_add(
+                1, std::memory_order_relaxed
+            );
+        }
+
+        static void _release_record(const size_t memory_id)
+            noexcept(!SAFE_PTR_TEST_BOOL)
+        {
+            if (!_has_record(memory_id)) {
+                return;
+            }
+            _Record& record = _find_record(memory_id);
+            if (record.ref_count.fetch_sub(1, std::memory_order_acq_rel)!=1) {
+                return;
+            }
+            if (
+                Alloc::requires_free &&
+                !record.is_deleted.load(std::memory_order_acquire)
+            ) {
+                _retire_record(record, true);
+                const AllocationSite& site = record.site != nullptr ?
+                    record.site->site : _get_unknown_site();
+                std::string message = "Memory allocated at ";
+                message += site.file;
+                message += ":" + std::to_string(site.line) + " in function ";
+                message += site.function;
+                message += " was leaked.";
+                #if SAFE_PTR_BACKTRACE_BOOL
+                    // the first leak of each site keeps its backtrace
+                    _Backtrace* expected = nullptr;
+                    if (record.backtrace != nullptr &&
+                        record.site->leak_backtrace.compare_exchange_strong(
+                            expected, record.backtrace
+                        )
+                    ) {
+                        std::ostringstream frames;
+                        _print_backtrace(frames, *record.backtrace);
+                        message += " It was allocated from:\n" + frames.str();
+                        record.backtrace = nullptr;
+                    }
+                #endif
+                SAFE_PTR_WARNING(message.c_str());
+                #if SAFE_PTR_INLINE_HEADER_BOOL
+                    return; // the storage of leaked memory stays allocated
+                #endif
+            }
+            _erase_record(memory_id);
+        }
+
+        static void _check_for_use_after_free(const size_t memory_id)
+            noexcept(!SAFE_PTR_TEST_BOOL)
+        {
+            if (!_has_record(memory_id)) {
+                return;
+            }
+            if (_find_record(memory_id).is_deleted.load(
+                std::memory_order_acquire
+            )) {
+                SAFE_PTR_WARNING(
+                    "Tried to access data after free() was called."
+                );
+            }
+        }
+
+        bool _get_is_view() const {
+            return _memory_id == 0 || (_memory_id & _SUBVIEW_BIT) != 0;
+        }
+
+        static bool _has_record(const size_t memory_id) {
+            return memory_id != 0 && memory_id != _UNSAMPLED_MEMORY_ID;
+        }
+
+        // memory id of the record, without the subview bit
+        size_t _get_record_id() const {
+            return _memory_id & ~_SUBVIEW_BIT;
+        }
+
+        // The functions above take the memory id, so CheckedRange can hold a
+        // record without a SafePtr; these apply them to this SafePtr.
+        _Record& _find_record() const {
+            return _find_record(_get_record_id());
+        }
+
+        void _erase_record() const {
+            _erase_record(_get_record_id());
+        }
+
+        void _acquire_record() const {
+            _acquire_record(_get_record_id());
+        }
+
+        void _release_record() const noexcept(!SAFE_PTR_TEST_BOOL) {
+            _release_record(_get_record_id());
+        }
+
+        void _check_for_use_after_free() const noexcept(!SAFE_PTR_TEST_BOOL) {
+            _check_for_use_after_free(_get_record_id());
+        }
+
+        bool _has_record() const {
+            return _has_record(_get_record_id());
+        }
+
+        // Checks that the memory can be replaced by assign() or resize().
+        void _check_can_reuse() const {
+            if (_get_is_view()) {
+                throw std::logic_error(
+                    "Tried to reallocate the memory of a view."
+                );
+            }
+            // the freed storage must not be moved from or written to again
+            // (default constructed SafePtrs have a deleted record too)
+            if (_begin != nullptr && _has_record() &&
+                _find_record().is_deleted.load(std::memory_order_acquire)
+            ) {
+                throw std::logic_error(
+                    "it was tried to reallocate the memory of a SafePtr "
+                    "after free() was called."
+                );
+            }
+        }
+
+        static void _warning(
+            const char* const msg,
+            const char* const file,
+            int line,
+            const char* const func
+        ) {
+        #if SAFE_PTR_TEST_BOOL
+            throw _SafePtrWarning();
+        #endif
+            std::cerr << "\033[33m"
+                    << "SafePtr warning at " << file << ":" << line
+                    << " in function " << func << ": "
+                    << "\033[0m" << msg << "\n";
+        }
+    #endif
+};
+
+#if SAFE_PTR_DEBUG_BOOL
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_UNSAMPLED_MEMORY_ID;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_SUBVIEW_BIT;
+#endif
+
+#if SAFE_PTR_INLINE_HEADER_BOOL
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr bool SafePtr<T,Alignment,Alloc>::_IS_HEADER_INLINE;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_HEADER_ALIGNMENT;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_HEADER_SIZE;
+#elif SAFE_PTR_DEBUG_BOOL
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_SHARD_BITS;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_SHARD_COUNT;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_INDEX_BITS;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_INDEX_MASK;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_MAX_SLOT_COUNT;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_MAX_GENERATION;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_FIRST_CHUNK_BITS;
+
+    template<typename T, size_t Alignment, typename Alloc>
+    constexpr size_t SafePtr<T,Alignment,Alloc>::_CHUNK_COUNT;
+
+#endif
+
+#if SAFE_PTR_POSIX_BOOL
+// Adds the header and the elements of `safe_ptr` to the buffers of
+// save_all(), and advances `header` and `buffer` past them.
+template<typename T, size_t Alignment, typename Alloc>
+int _add_save_buffers(
+    const SafePtr<T, Alignment, Alloc>& safe_ptr,
+    _SerialHeader*& header, iovec*& buffer
+) {
+    static_assert(
+        std::is_trivially_copyable<T>::value,
+        "SafePtr::save() requires a trivially copyable type"
+    );
+    const size_t size = safe_ptr.size();
+    *header = _make_serial_header(sizeof(T), size, safe_ptr.data());
+    buffer->iov_base = header++;
+    buffer->iov_len = sizeof(_SerialHeader);
+    ++buffer;
+    buffer->iov_base = const_cast<T*>(safe_ptr.data());
+    buffer->iov_len = size * sizeof(T);
+    ++buffer;
+    return 0;
+}
+
+// Saves the SafePtrs to `fd` one after the other, as SafePtr::save() does,
+// but with a single writev() for all of them (unless there are more than
+// IOV_MAX / 2 or it is interrupted).
+template<typename... Ptrs>
+void save_all(const int fd, const Ptrs&... safe_ptrs) {
+    static_assert(sizeof...(Ptrs) != 0, "save_all() requires a SafePtr");
+    _SerialHeader headers[sizeof...(Ptrs)];
+    iovec buffers[2 * sizeof...(Ptrs)];
+    _SerialHeader* header = headers;
+    iovec* buffer = buffers;
+    const int expand[] = {_add_save_buffers(safe_ptrs, header, buffer)...};
+    (void)expand;
+    _write_buffers(fd, buffers, 2 * sizeof...(Ptrs));
+}
+
+template<typename T, size_t Alignment, typename Alloc>
+int _add_load_buffers(
+    SafePtr<T, Alignment, Alloc>& safe_ptr,
+    _SerialHeader*& header, iovec*& buffer
+) {
+    static_assert(
+        std::is_trivially_copyable<T>::value,
+        "SafePtr::load() requires a trivially copyable type"
+    );
+    buffer->iov_base = header++;
+    buffer->iov_len = sizeof(_SerialHeader);
+    ++buffer;
+    buffer->iov_base = safe_ptr.data();
+    buffer->iov_len = safe_ptr.size() * sizeof(T);
+    ++buffer;
+    return 0;
+}
+
+template<typename T, size_t Alignment, typename Alloc>
+int _check_loaded(
+    const SafePtr<T, Alignment, Alloc>& safe_ptr, const _SerialHeader& header
+) {
+    _check_serial_header(header, sizeof(T));
+    if (header.count != safe_ptr.size()) {
+        throw std::invalid_argument(
+            "it was tried to load a SafePtr into one with another number of "
+            "elements"
+        );
+    }
+    _check_serial_checksum(header, safe_ptr.data());
+    return 0;
+}
+
+// Loads SafePtrs saved by save_all() (or by consecutive SafePtr::save()
+// calls) straight into the memory of existing SafePtrs, which may also be
+// views, with a single readv() for all of them. Each one must have as many
+// elements as the one that was saved. The headers are only checked after
+// the read, so the elements are unspecified if it throws.
+template<typename... Ptrs>
+void load_all(const int fd, Ptrs&... safe_ptrs) {
+    static_assert(sizeof...(Ptrs) != 0, "load_all() requires a SafePtr");
+    _SerialHeader headers[sizeof...(Ptrs)];
+    iovec buffers[2 * sizeof...(Ptrs)];
+    _SerialHeader* header = headers;
+    iovec* buffer = buffers;
+    const int expand[] = {_add_load_buffers(safe_ptrs, header, buffer)...};
+    (void)expand;
+    _read_buffers(fd, buffers, 2 * sizeof...(Ptrs));
+    const _SerialHeader* loaded = headers;
+    const int checks[] = {_check_loaded(safe_ptrs, *loaded++)...};
+    (void)checks;
+}
+#endif
+
+// Layouts of SafePtrND
+//
+// A layout has a `Mapping<Rank>` class that maps the indices of an element to
+// its offset in the storage, with the methods:
+// - `size_t extent(size_t dimension)`: the number of indices in `dimension`;
+// - `size_t operator()(const size_t* index)`: the offset of the element whose
+//   indices are the `Rank` values at `index`;
+// - `size_t required_size()`: the number of elements the storage must have;
+// - `size_t contiguous_dimension()`: the dimension along which elements are
+//   next to each other, or `Rank` if there is none.
+
+template<size_t Rank>
+size_t _get_product(const std::array<size_t, Rank>& extents) {
+    size_t product = 1;
+    for (const size_t extent : extents) {
+        product *= extent;
+    }
+    return product;
+}
+
+// Row-major: the last index is the contiguous one, like in C arrays.
+struct LayoutRight
+{
+    template<size_t Rank>
+    class Mapping
+    {
+    public:
+        explicit Mapping(const std::array<size_t, Rank>& extents)
+            : _extents(extents) {}
+
+        size_t extent(const size_t dimension) const {
+            return _extents[dimension];
+        }
+
+        size_t operator()(const size_t* const index) const {
+            size_t offset = index[0];
+            for (size_t dimension = 1; dimension != Rank; ++dimension) {
+                offset = offset * _extents[dimension] + index[dimension];
+            }
+            return offset;
+        }
+
+        size_t required_size() const {
+            return _get_product(_extents);
+        }
+
+        size_t contiguous_dimension() const {
+            return Rank - 1;
+        }
+
+    private:
+        std::array<size_t, Rank> _extents;
+    };
+};
+
+// Column-major: the first index is the contiguous one, like in Fortran.
+struct LayoutLeft
+{
+    template<size_t Rank>
+    class Mapping
+    {
+    public:
+        explicit Mapping(const std::array<size_t, Rank>& extents)
+            : _extents(extents) {}
+
+        size_t extent(const size_t dimension) const {
+            return _extents[dimension];
+        }
+
+        size_t operator()(const size_t* const index) const {
+            size_t offset = index[Rank-1];
+            for (size_t dimension = Rank-1; dimension != 0; --dimension) {
+                offset = offset * _extents[dimension-1] + index[dimension-1];
+            }
+            return offset;
+        }
+
+        size_t required_size() const {
+            return _get_product(_extents);
+        }
+
+        size_t contiguous_dimension() const {
+            return 0;
+        }
+
+    private:
+        std::array<size_t, Rank> _extents;
+    };
+};
+
+// Any distance in elements between consecutive indices of each dimension,
+// e.g. for every other column of a matrix or for a matrix inside a bigger
+// one.
+struct LayoutStride
+{
+    template<size_t Rank>
+    class Mapping
+    {
+    public:
+        Mapping(
+            const std::array<size_t, Rank>& extents,
+            const std::array<size_t, Rank>& strides
+        ) : _extents(extents), _strides(strides) {}
+
+        size_t extent(const size_t dimension) const {
+            return _extents[dimension];
+        }
+
+        size_t stride(const size_t dimension) const {
+            return _strides[dimension];
+        }
+
+        size_t operator()(const size_t* const index) const {
+            size_t offset = 0;
+            for (size_t dimension = 0; dimension != Rank; ++dimension) {
+                offset += index[dimension] * _strides[dimension];
+            }
+            return offset;
+        }
+
+        // offset of the last element, plus one
+        size_t required_size() const {
+            size_t size = 1;
+            for (size_t dimension = 0; dimension != Rank; ++dimension) {
+                if (_extents[dimension] == 0) {
+                    return 0;
+                }
+                size += (_extents[dimension] - 1) * _strides[dimension];
+            }
+            return size;
+        }
+
+        size_t contiguous_dimension() const {
+            for (size_t dimension = 0; dimension != Rank; ++dimension) {
+                if (_strides[dimension] == 1) {
+                    return dimension;
+                }
+            }
+            return Rank;
+        }
+
+    private:
+        std::array<size_t, Rank> _extents;
+        std::array<size_t, Rank> _strides;
+    };
+};
+
+// Matrices stored as tiles of `TileRows` x `TileCols` elements, so the
+// elements of each tile are next to each other (row-major inside the tile),
+// and the tiles are stored row by row. Loops that work on one tile at a time
+// keep it in the cache. The matrix is padded to whole tiles, so its storage
+// needs required_size() elements, not only rows * cols.
+template<size_t TileRows, size_t TileCols>
+struct LayoutTiled
+{
+    static_assert(
+        TileRows != 0 && TileCols != 0, "tiles must not be empty"
+    );
+
+    template<size_t Rank>
+    class Mapping
+    {
+        static_assert(Rank == 2, "LayoutTiled is only for matrices");
+
+    public:
+        static constexpr size_t tile_rows = TileRows;
+        static constexpr size_t tile_cols = TileCols;
+
+        explicit Mapping(const std::array<size_t, Rank>& extents)
+            : _extents(extents),
+              _tiles_per_row((extents[1] + TileCols - 1) / TileCols) {}
+
+        size_t extent(const size_t dimension) const {
+            return _extents[dimension];
+        }
+
+        size_t operator()(const size_t* const index) const {
+            return tile_offset(index[0] / TileRows, index[1] / TileCols)
+                + index[0] % TileRows * TileCols + index[1] % TileCols;
+        }
+
+        size_t required_size() const {
+            return tile_count(0) * _tiles_per_row * TileRows * TileCols;
+        }
+
+        size_t contiguous_dimension() const {
+            return Rank;
+        }
+
+        // number of tiles along `dimension`
+        size_t tile_count(const size_t dimension) const {
+            return dimension == 0
+                ? (_extents[0] + TileRows - 1) / TileRows
+                : _tiles_per_row;
+        }
+
+        size_t tile_offset(const size_t tile_row, const size_t tile_col) const {
+            return (tile_row * _tiles_per_row + tile_col) * TileRows * TileCols;
+        }
+
+    private:
+        std::array<size_t, Rank> _extents;
+        size_t _tiles_per_row;
+    };
+};
+
+template<size_t TileRows, size_t TileCols>
+template<size_t Rank>
+constexpr size_t LayoutTiled<TileRows, TileCols>::Mapping<Rank>::tile_rows;
+
+template<size_t TileRows, size_t TileCols>
+template<size_t Rank>
+constexpr size_t LayoutTiled<TileRows, TileCols>::Mapping<Rank>::tile_cols;
+
+// Multidimensional view of the elements of a SafePtr, which stay where they
+// are. `Layout` maps the `Rank` indices of an element to its position in the
+// SafePtr. Like views from SafePtr::subview(), in debug mode a SafePtrND is
+// checked for use after the SafePtr is freed, and its indices are checked to
+// be in bounds. Copies are views of the same elements.
+//
+// operator() finds an element from its indices. Loops that go through many
+// elements should rather use span() or tile(), which return contiguous
+// elements as a CheckedRange, so they are validated once and then accessed
+// like raw pointers, which the compiler can vectorize.
+template<
+    typename T,
+    size_t Rank,
+    typename Layout = LayoutRight,
+    size_t Alignment = alignof(T),
+    typename Alloc = DefaultAllocator
+>
+class SafePtrND
+{
+    static_assert(Rank != 0, "a SafePtrND must have at least one dimension");
+
+    // SafePtr of non-const elements, which a SafePtrND of const ones can view
+    using _Source =
+        SafePtr<typename std::remove_const<T>::type, Alignment, Alloc>;
+    using _CopySource = typename std::conditional<
+        std::is_const<T>::value, const SafePtrND&, SafePtrND&
+    >::type;
+
+public:
+    using Storage = SafePtr<T, Alignment, Alloc>;
+    using Mapping = typename Layout::template Mapping<Rank>;
+    using Span = typename Storage::template CheckedRange<T>;
+    using ConstSpan = typename Storage::template CheckedRange<const T>;
+
+    // constructor
+    SafePtrND(Storage& storage, const std::array<size_t, Rank>& extents)
+        : SafePtrND(storage, Mapping(extents)) {}
+
+    // constructor
+    SafePtrND(Storage& storage, const Mapping& mapping)
+        : _mapping(mapping),
+          _storage(_get_view(storage, mapping.required_size())) {}
+
+    // constructor, for a view of a const SafePtr, whose elements can only be
+    // read, so T must be const, e.g. SafePtr2D<const float>
+    SafePtrND(const _Source& storage, const std::array<size_t, Rank>& extents)
+        : SafePtrND(storage, Mapping(extents)) {}
+
+    // constructor, for a view of a const SafePtr
+    SafePtrND(const _Source& storage, const Mapping& mapping)
+        : _mapping(mapping),
+          _storage(_get_view(storage, mapping.required_size())) {
+        static_assert(
+            std::is_const<T>::value,
+            "a SafePtrND of a const SafePtr must have const elements"
+        );
+    }
+
+    // copy constructor. Like SafePtr::subview(), a SafePtrND whose elements
+    // can be written is only copied from a non-const one.
+    SafePtrND(_CopySource other)
+        : _mapping(other._mapping),
+          _storage(_get_view(other._storage, other._storage.size())) {}
+
+    // copy assignment operator
+    SafePtrND& operator=(_CopySource other) {
+        _storage = _get_view(other._storage, other._storage.size());
+        _mapping = other._mapping;
+        return *this;
+    }
+
+    SafePtrND(SafePtrND&&) = default;
+    SafePtrND& operator=(SafePtrND&&) = default;
+
+    static constexpr size_t rank() {
+        return Rank;
+    }
+
+    size_t extent(const size_t dimension) const {
+        return _mapping.extent(dimension);
+    }
+
+    // number of elements, without the padding of some layouts
+    size_t size() const {
+        std::array<size_t, Rank> extents;
+        for (size_t dimension = 0; dimension != Rank; ++dimension) {
+            extents[dimension] = _mapping.extent(dimension);
+        }
+        return _get_product(extents);
+    }
+
+    const Mapping& mapping() const {
+        return _mapping;
+    }
+
+    T* data() {
+        return _storage.data();
+    }
+
+    const T* data() const {
+        return _storage.data();
+    }
+
+    template<typename... Indices>
+    T& operator()(const Indices... indices) {
+        return _storage[_find(SAFE_PTR_DEBUG_BOOL, indices...)];
+    }
+
+    template<typename... Indices>
+    const T& operator()(const Indices... indices) const {
+        return _storage[_find(SAFE_PTR_DEBUG_BOOL, indices...)];
+    }
+
+    template<typename... Indices>
+    T& at(const Indices... indices) {
+        return _storage[_find(true, indices...)];
+    }
+
+    template<typename... Indices>
+    const T& at(const Indices... indices) const {
+        return _storage[_find(true, indices...)];
+    }
+
+    // Returns the elements along the contiguous dimension of the layout whose
+    // other indices are `indices`, e.g. `span(i)` is the row `i` of a
+    // row-major matrix and the column `i` of a column-major one. Throws if
+    // the layout has no contiguous dimension.
+    template<typename... Indices>
+    Span span(const Indices... indices) {
+        const std::pair<size_t, size_t> range = _find_span(indices...);
+        return _storage.checked(range.first, range.second);
+    }
+
+    template<typename... Indices>
+    ConstSpan span(const Indices... indices) const {
+        const std::pair<size_t, size_t> range = _find_span(indices...);
+        return _storage.checked(range.first, range.second);
+    }
+
+    // Returns the tile_rows * tile_cols elements of a tile of a LayoutTiled
+    // matrix, which are stored row by row. The tiles at the bottom and right
+    // edges include padding elements when the matrix size is not a multiple
+    // of the tile size.
+    Span tile(const size_t tile_row, const size_t tile_col) {
+        return _storage.checked(
+            _find_tile(tile_row, tile_col),
+            Mapping::tile_rows * Mapping::tile_cols
+        );
+    }
+
+    ConstSpan tile(const size_t tile_row, const size_t tile_col) const {
+        return _storage.checked(
+            _find_tile(tile_row, tile_col),
+            Mapping::tile_rows * Mapping::tile_cols
+        );
+    }
+
+    size_t tile_count(const size_t dimension) const {
+        return _mapping.tile_count(dimension);
+    }
+
+private:
+    Mapping _mapping;
+    Storage _storage; // subview of the storage
+
+    // Returns a subview, which can only be read when `storage` is const.
+    template<typename Source>
+    static Storage _get_view(Source& storage, const size_t size) {
+        if (size > storage.size()) {
+            throw std::invalid_argument(
+                "the SafePtr is too small for the SafePtrND extents"
+            );
+        }
+        return storage.subview(0, size);
+    }
+
+    template<typename... Indices>
+    size_t _find(const bool check_bounds, const Indices... indices) const {
+        static_assert(
+            sizeof...(Indices) == Rank,
+            "a SafePtrND element needs one index per dimension"
+        );
+        const size_t index[Rank] = {static_cast<size_t>(indices)...};
+        if (check_bounds) {
+            _check_bounds(index);
+        }
+        return _mapping(index);
     }
 
-    void free() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            if (_get_is_deleted()) {
-                throw std::logic_error(
-                    "it was tried to free the memory of a SafePtr that does "
-                    "not own data."
-                );
+    // Returns the position and the size of a span.
+    template<typename... Indices>
+    std::pair<size_t, size_t> _find_span(const Indices... indices) const {
+        static_assert(
+            sizeof...(Indices) + 1 == Rank,
+            "a SafePtrND span needs one index per dimension but one"
+        );
+        const size_t contiguous = _mapping.contiguous_dimension();
+        if (contiguous == Rank) {
+            throw std::logic_error(
+                "tried to get a span of a SafePtrND layout that has no "
+                "contiguous dimension"
+            );
+        }
+        const size_t others[Rank] = {static_cast<size_t>(indices)...};
+        size_t index[Rank];
+        for (size_t dimension = 0, i = 0; dimension != Rank; ++dimension) {
+            if (dimension == contiguous) {
+                index[dimension] = 0;
+                continue;
             }
-            if (_get_is_view()) {
-                throw std::logic_error(
-                    "it was tried to free the memory of a view"
+            // the contiguous extent may be 0, which gives an empty span
+            if (others[i] >= _mapping.extent(dimension)) {
+                throw std::out_of_range(
+                    "tried to access SafePtrND span out of range"
                 );
             }
-            _get_is_deleted() = true;
-        #endif
-        delete[] _begin;
+            index[dimension] = others[i++];
+        }
+        const size_t count = _mapping.extent(contiguous);
+        return std::make_pair(count == 0 ? 0 : _mapping(index), count);
     }
 
-    static SafePtr<T> make_view(T* const data, const size_t size) {
-        SafePtr<T> safe_ptr;
-        #if SAFE_PTR_DEBUG_BOOL
-            std::lock_guard<std::mutex> lock(_mtx);
-            safe_ptr._memory_id = 0;
-        #endif
-        safe_ptr._begin = data;
-        safe_ptr._end = data + size;
-        return safe_ptr;
+    size_t _find_tile(const size_t tile_row, const size_t tile_col) const {
+        if (
+            tile_row >= _mapping.tile_count(0) ||
+            tile_col >= _mapping.tile_count(1)
+        ) {
+            throw std::out_of_range(
+                "tried to access SafePtrND tile out of range"
+            );
+        }
+        return _mapping.tile_offset(tile_row, tile_col);
     }
 
-    size_t size() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return _end - _begin;
+    void _check_bounds(const size_t* const index) const {
+        for (size_t dimension = 0; dimension != Rank; ++dimension) {
+            if (index[dimension] >= _mapping.extent(dimension)) {
+                throw std::out_of_range(
+                    "tried to access SafePtrND element out of range"
+                );
+            }
+        }
     }
+};
 
-    const T* begin() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return _begin;
-    }
+template<
+    typename T,
+    typename Layout = LayoutRight,
+    size_t Alignment = alignof(T),
+    typename Alloc = DefaultAllocator
+>
+using SafePtr2D = SafePtrND<T, 2, Layout, Alignment, Alloc>;
 
-    T* begin() {
-        return const_cast<T*>(
-            const_cast<const SafePtr<T>&>(*this).begin()
-        );
-    }
+template<bool...>
+struct _BoolPack {};
 
-    const T* cbegin() const {
-        return begin();
+// C++11-compatible replacement for std::index_sequence (which is C++14)
+template<size_t... Indices>
+struct _IndexSequence {};
+
+template<size_t Count, size_t... Indices>
+struct _MakeIndexSequence
+    : _MakeIndexSequence<Count - 1, Count - 1, Indices...> {};
+
+template<size_t... Indices>
+struct _MakeIndexSequence<0, Indices...> {
+    using type = _IndexSequence<Indices...>;
+};
+
+// Whether all `Values` are true.
+template<bool... Values>
+struct _AllOf : std::is_same<
+    _BoolPack<Values..., true>, _BoolPack<true, Values...>
+> {};
+
+// Structure of arrays: `size` rows of `Fields`, stored as one array per
+// field (a column), so loops over one field only read that field from
+// memory. The columns are placed in a single allocation, each one aligned
+// to a cache line, which is owned by a SafePtr: a SafeSoA must be freed
+// with free(), and is checked for leaks and use after free like a SafePtr.
+// Copies are deep, and moves share the memory, also like a SafePtr.
+//
+// operator[] returns a row as a tuple of references to its fields. Loops
+// over a field should rather use column<I>(), which returns a range like
+// SafePtr::checked(), so they run on raw pointers.
+template<typename... Fields>
+class SafeSoA
+{
+    static constexpr size_t _COLUMN_ALIGNMENT = 64;
+
+    static_assert(sizeof...(Fields) != 0, "a SafeSoA must have fields");
+    static_assert(
+        _AllOf<std::is_trivially_copyable<Fields>::value...>::value,
+        "the fields of a SafeSoA must be trivially copyable"
+    );
+    static_assert(
+        _AllOf<(alignof(Fields) <= _COLUMN_ALIGNMENT)...>::value,
+        "the fields of a SafeSoA must not be aligned to more than 64 bytes"
+    );
+
+    using _Block = SafePtr<unsigned char, _COLUMN_ALIGNMENT>;
+    using _Indices = typename _MakeIndexSequence<sizeof...(Fields)>::type;
+
+public:
+    template<size_t I>
+    using Field = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+    template<size_t I>
+    using Column = typename _Block::template CheckedRange<Field<I>>;
+
+    template<size_t I>
+    using ConstColumn = typename _Block::template CheckedRange<const Field<I>>;
+
+    using Reference = std::tuple<Fields&...>;
+    using ConstReference = std::tuple<const Fields&...>;
+
+    // constructor
+    SafeSoA() : _size(0), _offsets() {}
+
+    // constructor
+    // The fields are not written to, as in SafePtr::uninitialized().
+    explicit SafeSoA(
+        const size_t size, const AllocationSite& site = AllocationSite()
+    ) : _size(size),
+        _offsets(_get_offsets(size)),
+        _block(_Block::uninitialized(_offsets[sizeof...(Fields)], site)) {}
+
+    // constructor
+    // Every row is set to `values`.
+    SafeSoA(
+        const size_t size,
+        const Fields&... values,
+        const AllocationSite& site = AllocationSite()
+    ) : SafeSoA(size, site) {
+        fill(values...);
     }
 
-    const T* cbegin() {
-        return const_cast<const SafePtr<T>&>(*this).cbegin();
+    void free() const {
+        _block.free();
     }
 
-    const T* end() const {
+    size_t size() const {
         #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
+            _block.size(); // checks for use after free
         #endif
-        return _end;
+        return _size;
     }
 
-    T* end() {
-        return const_cast<T*>(
-            const_cast<const SafePtr<T>&>(*this).end()
+    bool empty() const {
+        return size() == 0;
+    }
+
+    Reference operator[](const size_t index) {
+        return _get_row<Reference>(
+            _block.data(), index,
+            _Indices{}
         );
     }
 
-    const T* cend() const {
-        return end();
+    ConstReference operator[](const size_t index) const {
+        return _get_row<ConstReference>(
+            _block.data(), index,
+            _Indices{}
+        );
     }
 
-    const T* cend() {
-        return const_cast<const SafePtr<T>&>(*this).cend();
+    Reference at(const size_t index) {
+        _check_index(index);
+        return (*this)[index];
     }
 
-    const T& operator[](const size_t index) const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return *(_begin + index);
+    ConstReference at(const size_t index) const {
+        _check_index(index);
+        return (*this)[index];
     }
 
-    T& operator[](const size_t index) {
-        return const_cast<T&>(
-            const_cast<const SafePtr<T>&>(*this)[index]
-        );
+    // Returns field I of row `index`.
+    template<size_t I>
+    Field<I>& get(const size_t index) {
+        return _get_column<I>(_block.data())[index];
     }
 
-    const T& at(const size_t index) const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        if (index >= this->size()) {
-            throw std::out_of_range(
-                "tried to access SafePtr element out of range"
-            );
-        }
-        return *(_begin + index);
+    template<size_t I>
+    const Field<I>& get(const size_t index) const {
+        return _get_column<I>(_block.data())[index];
     }
 
-    T& at(const size_t index) {
-        return const_cast<T&>(
-            const_cast<const SafePtr<T>&>(*this).at(index)
-        );
+    // Returns the elements of field I, which are contiguous and aligned to a
+    // cache line.
+    template<size_t I>
+    Column<I> column() {
+        return _block.template _checked_as<Field<I>>(_offsets[I], _size);
     }
 
-    bool empty() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return this->size() == 0;
+    template<size_t I>
+    ConstColumn<I> column() const {
+        return _block.template _checked_as<Field<I>>(_offsets[I], _size);
     }
 
-    const T* data() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return _begin;
+    void fill(const Fields&... values) {
+        _fill(_block.data(), _Indices{}, values...);
     }
 
-    T* data() {
-        return const_cast<T*>(
-            const_cast<const SafePtr<T>&>(*this).data()
-        );
+private:
+    size_t _size;
+    // byte offset of each column, and the size of the block at the end
+    std::array<size_t, sizeof...(Fields) + 1> _offsets;
+    _Block _block;
+
+    static std::array<size_t, sizeof...(Fields) + 1>
+    _get_offsets(const size_t size) {
+        const size_t field_sizes[] = {sizeof(Fields)...};
+        std::array<size_t, sizeof...(Fields) + 1> offsets;
+        size_t offset = 0;
+        for (size_t i = 0; i != sizeof...(Fields); ++i) {
+            offsets[i] = offset;
+            const size_t max_size = std::numeric_limits<size_t>::max() - offset
+                - _COLUMN_ALIGNMENT;
+            if (size > max_size / field_sizes[i]) {
+                throw std::bad_array_new_length();
+            }
+            offset += (size * field_sizes[i] + _COLUMN_ALIGNMENT - 1)
+                / _COLUMN_ALIGNMENT * _COLUMN_ALIGNMENT;
+        }
+        offsets[sizeof...(Fields)] = offset;
+        return offsets;
     }
 
-    const T& front() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return *(this->_begin);
+    template<size_t I>
+    Field<I>* _get_column(unsigned char* const block) const {
+        return reinterpret_cast<Field<I>*>(block + _offsets[I]);
     }
 
-    T& front() {
-        return const_cast<T&> (
-            const_cast<const SafePtr<T>&>(*this).front()
-        );
+    template<size_t I>
+    const Field<I>* _get_column(const unsigned char* const block) const {
+        return reinterpret_cast<const Field<I>*>(block + _offsets[I]);
     }
 
-    const T& back() const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        return *(this->_end-1);
+    template<typename Row, typename Byte, size_t... Is>
+    Row _get_row(
+        Byte* const block, const size_t index, _IndexSequence<Is...>
+    ) const {
+        return Row(_get_column<Is>(block)[index]...);
     }
 
-    T& back() {
-        return const_cast<T&>(
-            const_cast<const SafePtr<T>&>(*this).back()
-        );
+    template<size_t... Is>
+    void _fill(
+        unsigned char* const block, _IndexSequence<Is...>,
+        const Fields&... values
+    ) {
+        const int expand[] = {
+            (std::fill_n(_get_column<Is>(block), _size, values), 0)...
+        };
+        (void)expand;
     }
 
-    void fill(const T& value) {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        for (auto& p : *this) {
-            p = value;
+    void _check_index(const size_t index) const {
+        if (index >= size()) {
+            throw std::out_of_range(
+                "tried to access SafeSoA row out of range"
+            );
         }
     }
+};
 
-    void
-    print_all(const char* const variable_name = "SafePtr::print_all") const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
-        std::cout << variable_name << ": {\n";
-        if (!empty()) {
-            size_t idx = 0;
-            for (const T* it = cbegin(); it != cend()-1; ++it) {
-                std::cout << "    " << idx << ": " << *it << ",\n";
-                ++idx;
+template<typename... Fields>
+constexpr size_t SafeSoA<Fields...>::_COLUMN_ALIGNMENT;
+
+// Pool of threads that run the tasks given to run() together with the
+// calling thread. The tasks are split into one contiguous range per thread,
+// and a thread that runs out of tasks steals half of the tasks left in the
+// range of another thread, so uneven tasks still keep every thread busy.
+// The threads are started once and wait for tasks between run() calls.
+class ThreadPool
+{
+public:
+    // `thread_count` includes the thread that calls run(). 0 means
+    // std::thread::hardware_concurrency().
+    explicit ThreadPool(size_t thread_count = 0)
+        : _generation(0), _is_stopping(false), _running_count(0)
+    {
+        if (thread_count == 0) {
+            thread_count = std::max<size_t>(
+                std::thread::hardware_concurrency(), 1
+            );
+        }
+        _queues.reset(new _Queue[thread_count]);
+        _threads.reserve(thread_count - 1);
+        for (size_t i = 1; i != thread_count; ++i) {
+            try {
+                _threads.emplace_back(&ThreadPool::_work, this, i);
+            } catch (const std::system_error&) {
+                break; // run with the threads that could be started
             }
-            std::cout << "    " << idx << ": " << back() << "\n";
         }
-        std::cout << "}\n";
     }
 
-    void print(const char* const variable_name = "SafePtr::print") const {
-        #if SAFE_PTR_DEBUG_BOOL
-            _check_for_use_after_free();
-        #endif
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _is_stopping = true;
+        }
+        _wake.notify_all();
+        for (std::thread& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
-        constexpr size_t MAX_ELEMENTS_TO_PRINT = 26;
-        if (size() <= MAX_ELEMENTS_TO_PRINT) {
-            print_all(variable_name);
+    size_t thread_count() const {
+        return _threads.size() + 1;
+    }
+
+    // Calls `f(task)` for every task in [0, task_count) and returns when all
+    // calls returned. If a call throws, the tasks that did not start yet are
+    // skipped and the first exception is rethrown. Calls to run() from
+    // inside a task run their tasks in the calling thread.
+    template<typename F>
+    void run(const size_t task_count, F f) {
+        if (task_count == 0) {
+            return;
+        }
+        if (_threads.empty() || task_count == 1 || _is_in_task()) {
+            for (size_t task = 0; task != task_count; ++task) {
+                f(task);
+            }
             return;
         }
-        
-        constexpr size_t ELEMENTS_BEFORE_DOTS = 13;
-        constexpr size_t ELEMENTS_AFTER_DOTS = 12;
-        std::cout << variable_name << ": {\n";
-        size_t idx = 0;
-        for (const T* it=cbegin(); it!=cbegin()+ELEMENTS_BEFORE_DOTS; ++it) {
-            std::cout << "    " << idx << ": " << *it << ",\n";
-            ++idx;
+        std::lock_guard<std::mutex> run_lock(_run_mtx);
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _call = [](void* const context, const size_t task) {
+                (*static_cast<F*>(context))(task);
+            };
+            _context = &f;
+            _error = nullptr;
+            _has_failed.store(false, std::memory_order_relaxed);
+            const size_t queue_count = thread_count();
+            for (size_t i = 0; i != queue_count; ++i) {
+                std::lock_guard<std::mutex> queue_lock(_queues[i].mtx);
+                _queues[i].begin = task_count * i / queue_count;
+                _queues[i].end = task_count * (i + 1) / queue_count;
+            }
+            _running_count = _threads.size();
+            ++_generation;
         }
-        idx = size() - ELEMENTS_AFTER_DOTS;
-        std::cout << "    ...\n";
-        for (const T* it = cend()-ELEMENTS_AFTER_DOTS; it != cend()-1; ++it) {
-            std::cout << "    " << idx << ": " << *it << ",\n";
-            ++idx;
+        _wake.notify_all();
+        _run_tasks(0);
+        std::unique_lock<std::mutex> lock(_mtx);
+        _done.wait(lock, [this]() { return _running_count == 0; });
+        if (_error) {
+            std::rethrow_exception(_error);
         }
-        std::cout << "    " << idx << ": " << back() << "\n";
-        std::cout << "}\n";
     }
 
-private:
-    T* _begin; // points to the first element
-    T* _end;   // points to the byte after the last byte of the last element
+    // Pool with std::thread::hardware_concurrency() threads, used by the
+    // functions of fz::parallel by default. It is created on first use.
+    static ThreadPool& get_default() {
+        static ThreadPool pool;
+        return pool;
+    }
 
-    // C++11-compatible replacement for std::void_t (which is C++17)
-    template<typename...>
-    struct _sp_void { using type = void; };
-    template<typename... Ts>
-    using _sp_void_t = typename _sp_void<Ts...>::type;
+private:
+    // tasks [begin, end) that are left for one thread, padded so the
+    // queues of different threads are not in the same cache line (alignas
+    // would need the aligned operator new of C++17)
+    struct _Queue {
+        std::mutex mtx;
+        size_t begin = 0;
+        size_t end = 0;
+        char padding[64];
+    };
 
-    // Detects whether subtracting the iterators to get the size is valid.
-    template<typename It, typename = void>
-    struct _sp_has_subtraction : std::false_type {};
+    std::unique_ptr<_Queue[]> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _run_mtx; // one run() at a time
+    std::mutex _mtx;     // guards the members below
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    size_t _generation; // incremented by every run()
+    bool _is_stopping;
+    size_t _running_count; // threads that did not finish the current run()
+    void (*_call)(void*, size_t) = nullptr;
+    void* _context = nullptr;
+    std::exception_ptr _error;
+    std::atomic<bool> _has_failed{false};
 
-    template<typename It>
-    struct _sp_has_subtraction<
-        It,
-        _sp_void_t<decltype(std::declval<It>() - std::declval<It>())>
-    > : std::true_type {};
+    static bool& _is_in_task() {
+        static thread_local bool is_in_task = false;
+        return is_in_task;
+    }
 
-    // Allocates memory by subtracting the iterators to get the size (faster).
-    template<typename InputIt>
-    void _construct_from_range(
-        InputIt first, InputIt last, std::true_type
-    ) {
-        const size_t n = static_cast<size_t>(last - first);
-        _begin = new T[n];
-        _end = _begin + n;
-        std::copy(first, last, _begin);
+    void _work(const size_t index) {
+        size_t generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _wake.wait(lock, [&]() {
+                    return _is_stopping || _generation != generation;
+                });
+                if (_is_stopping) {
+                    return;
+                }
+                generation = _generation;
+            }
+            _run_tasks(index);
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (--_running_count == 0) {
+                _done.notify_one();
+            }
+        }
     }
 
-    // Allocates memory by iterating along the range to count size (slower).
-    template<typename InputIt>
-    void _construct_from_range(
-        InputIt first, InputIt last, std::false_type
-    ) {
-        size_t n = 0;
-        for (InputIt it = first; it != last; ++it) {
-            ++n;
+    // Runs the tasks of the queue `index`, then steals from the others
+    // until there are no tasks left.
+    void _run_tasks(const size_t index) {
+        _is_in_task() = true;
+        size_t task;
+        while (
+            !_has_failed.load(std::memory_order_relaxed) &&
+            (_pop(index, task) || _steal(index, task))
+        ) {
+            try {
+                _call(_context, task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_mtx);
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+                _has_failed.store(true, std::memory_order_relaxed);
+            }
         }
-        _begin = new T[n];
-        _end = _begin + n;
-        std::copy(first, last, _begin);
+        _is_in_task() = false;
     }
 
-    #if SAFE_PTR_DEBUG_BOOL
-        size_t _memory_id; // 0 is for if the ptr is a view
-        static size_t _next_available_memory_id;
-        static std::unordered_map<size_t,size_t> _ref_count;
-        static std::unordered_map<size_t,bool> _is_deleted;
-        static bool _id_overflow_occurred;
-        static std::mutex _mtx;
+    bool _pop(const size_t index, size_t& task) {
+        _Queue& queue = _queues[index];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if (queue.begin == queue.end) {
+            return false;
+        }
+        task = queue.begin++;
+        return true;
+    }
 
-        static size_t& _get_new_memory_id() {
-            ++_next_available_memory_id;
-            if (_next_available_memory_id == 0) {
-                _id_overflow_occurred = true;
+    // Moves the second half of the biggest queue to the queue `index` and
+    // takes its first task.
+    bool _steal(const size_t index, size_t& task) {
+        const size_t queue_count = thread_count();
+        for (size_t attempt = 0; attempt != 2; ++attempt) {
+            size_t victim = queue_count;
+            size_t victim_size = 0;
+            for (size_t i = 0; i != queue_count; ++i) {
+                std::lock_guard<std::mutex> lock(_queues[i].mtx);
+                const size_t size = _queues[i].end - _queues[i].begin;
+                if (i != index && size > victim_size) {
+                    victim = i;
+                    victim_size = size;
+                }
             }
-            if (!_id_overflow_occurred) {
-                return _next_available_memory_id;
+            if (victim == queue_count) {
+                return false;
             }
-            while (true) { // handle overflow
-                if (_ref_count.count(_next_available_memory_id) == 0) {
-                    return _next_available_memory_id;
+            size_t begin;
+            size_t end;
+            {
+                std::lock_guard<std::mutex> lock(_queues[victim].mtx);
+                const size_t size = _queues[victim].end - _queues[victim].begin;
+                if (size == 0) {
+                    continue; // emptied in the meantime, look again
                 }
-                ++_next_available_memory_id;
+                end = _queues[victim].end;
+                begin = end - (size + 1) / 2;
+                _queues[victim].end = begin;
             }
+            std::lock_guard<std::mutex> lock(_queues[index].mtx);
+            _queues[index].begin = begin + 1;
+            _queues[index].end = end;
+            task = begin;
+            return true;
         }
+        return false;
+    }
+};
 
-        void _check_for_use_after_free() const noexcept(!SAFE_PTR_TEST_BOOL) {
-            if (_get_is_deleted() == true) {
-                SAFE_PTR_WARNING(
-                    "Tried to access data after free() was called."
-                );
-            }
-        }
+// Algorithms that split a SafePtr (or a view of one) into chunks of
+// SAFE_PTR_PARALLEL_CHUNK_BYTES and process the chunks in the threads of a
+// ThreadPool. The chunks only depend on the size of the SafePtr, and the
+// results of reduce() and inclusive_scan() are combined chunk by chunk in
+// order, so they are the same for every run and every number of threads,
+// also for floating point types (though not the same as a sequential loop,
+// which combines the elements in a different order).
+namespace parallel {
 
-        bool _get_is_view() const {
-            return _memory_id == 0;
-        }
+template<typename T>
+size_t _get_chunk_size() {
+    return std::max<size_t>(SAFE_PTR_PARALLEL_CHUNK_BYTES / sizeof(T), 1);
+}
+
+inline size_t _get_chunk_count(const size_t size, const size_t chunk_size) {
+    return size / chunk_size + (size % chunk_size != 0);
+}
+
+// Result of one chunk. The results of the chunks are written by different
+// threads, so each is an object of its own (std::vector<bool> would pack
+// them into shared words) and is padded so no two share a cache line.
+template<typename T>
+struct _ChunkResult {
+    T value;
+    char padding[64];
+};
+
+// Calls `f(first, last)` for the elements of every chunk.
+template<typename T, typename F>
+void _for_each_chunk(T* const data, const size_t size, ThreadPool& pool, F f) {
+    const size_t chunk_size = _get_chunk_size<T>();
+    pool.run(_get_chunk_count(size, chunk_size), [&](const size_t chunk) {
+        T* const first = data + chunk * chunk_size;
+        f(first, first + std::min(chunk_size, size - chunk * chunk_size));
+    });
+}
 
-        size_t& _get_ref_count() const {
-            return _ref_count.at(_memory_id);
+// Calls `f(element)` for every element.
+template<typename T, size_t Alignment, typename Alloc, typename F>
+void for_each(
+    SafePtr<T, Alignment, Alloc>& ptr, F f,
+    ThreadPool& pool = ThreadPool::get_default()
+) {
+    _for_each_chunk(ptr.data(), ptr.size(), pool, [&](T* first, T* last) {
+        for (; first != last; ++first) {
+            f(*first);
         }
+    });
+}
 
-        bool& _get_is_deleted() const {
-            return _is_deleted.at(_memory_id);
+// Assigns `f(input[i])` to `output[i]`. Both must have the same size, and
+// may be the same SafePtr.
+template<
+    typename T, size_t InputAlignment, typename InputAlloc,
+    typename U, size_t OutputAlignment, typename OutputAlloc,
+    typename F
+>
+void transform(
+    const SafePtr<T, InputAlignment, InputAlloc>& input,
+    SafePtr<U, OutputAlignment, OutputAlloc>& output,
+    F f,
+    ThreadPool& pool = ThreadPool::get_default()
+) {
+    if (input.size() != output.size()) {
+        throw std::invalid_argument(
+            "tried to transform a SafePtr into one of a different size"
+        );
+    }
+    const T* const in = input.data();
+    U* const out = output.data();
+    _for_each_chunk(in, input.size(), pool, [&](const T* it, const T* last) {
+        for (U* dest = out + (it - in); it != last; ++it, ++dest) {
+            *dest = f(*it);
         }
+    });
+}
 
-        void _warning(
-            const char* const msg,
-            const char* const file,
-            int line,
-            const char* const func
-        ) const {
-        #if SAFE_PTR_TEST_BOOL
-            throw _SafePtrWarning();
-        #endif
-            std::cerr << "\033[33m"
-                    << "SafePtr warning at " << file << ":" << line
-                    << " in function " << func << ": "
-                    << "\033[0m" << msg << "\n";
+// Returns `init` combined with all the elements by `op`, which must be
+// associative.
+template<typename T, size_t Alignment, typename Alloc, typename BinaryOp>
+T reduce(
+    const SafePtr<T, Alignment, Alloc>& input, const T init, BinaryOp op,
+    ThreadPool& pool = ThreadPool::get_default()
+) {
+    const T* const in = input.data();
+    const size_t size = input.size();
+    const size_t chunk_size = _get_chunk_size<T>();
+    std::vector<_ChunkResult<T>> partials(
+        _get_chunk_count(size, chunk_size), _ChunkResult<T>{init, {}}
+    );
+    _for_each_chunk(in, size, pool, [&](const T* it, const T* const last) {
+        T partial = *it;
+        for (++it; it != last; ++it) {
+            partial = op(partial, *it);
         }
-    #endif
-};
+        partials[(last - 1 - in) / chunk_size].value = partial;
+    });
+    T result = init;
+    for (const _ChunkResult<T>& partial : partials) {
+        result = op(result, partial.value);
+    }
+    return result;
+}
 
-#if SAFE_PTR_DEBUG_BOOL
-    template<typename T>
-    size_t SafePtr<T>::_next_available_memory_id = 1;
+// Returns the sum of `init` and all the elements.
+template<typename T, size_t Alignment, typename Alloc>
+T reduce(
+    const SafePtr<T, Alignment, Alloc>& input, const T init = T(),
+    ThreadPool& pool = ThreadPool::get_default()
+) {
+    return reduce(input, init, std::plus<T>(), pool);
+}
 
-    template<typename T>
-    std::unordered_map<size_t,size_t> SafePtr<T>::_ref_count;
+// Assigns to `output[i]` the elements up to `input[i]` combined by `op`,
+// which must be associative. Both must have the same size, and may be the
+// same SafePtr.
+template<
+    typename T, size_t InputAlignment, typename InputAlloc,
+    size_t OutputAlignment, typename OutputAlloc,
+    typename BinaryOp = std::plus<T>
+>
+void inclusive_scan(
+    const SafePtr<T, InputAlignment, InputAlloc>& input,
+    SafePtr<T, OutputAlignment, OutputAlloc>& output,
+    BinaryOp op = BinaryOp(),
+    ThreadPool& pool = ThreadPool::get_default()
+) {
+    if (input.size() != output.size()) {
+        throw std::invalid_argument(
+            "tried to scan a SafePtr into one of a different size"
+        );
+    }
+    const T* const in = input.data();
+    T* const out = output.data();
+    const size_t size = input.size();
+    const size_t chunk_size = _get_chunk_size<T>();
+    const size_t chunk_count = _get_chunk_count(size, chunk_size);
+    if (chunk_count == 0) {
+        return;
+    }
 
-    template <typename T>
-    std::unordered_map<size_t, bool> SafePtr<T>::_is_deleted = [] {
-        std::unordered_map<size_t, bool> m;
-        m[0] = false;
-        return m;
-    }();
+    // the last elements of the scan of each chunk, except the last chunk
+    std::vector<_ChunkResult<T>> carries(
+        chunk_count - 1, _ChunkResult<T>{in[0], {}}
+    );
+    pool.run(chunk_count - 1, [&](const size_t chunk) {
+        const T* it = in + chunk * chunk_size;
+        const T* const last = it + chunk_size;
+        T carry = *it;
+        for (++it; it != last; ++it) {
+            carry = op(carry, *it);
+        }
+        carries[chunk].value = carry;
+    });
+    for (size_t chunk = 1; chunk < carries.size(); ++chunk) {
+        carries[chunk].value =
+            op(carries[chunk - 1].value, carries[chunk].value);
+    }
 
-    template<typename T>
-    bool SafePtr<T>::_id_overflow_occurred = false;
-    
-    template<typename T>
-    std::mutex SafePtr<T>::_mtx;
-#endif
+    _for_each_chunk(in, size, pool, [&](const T* it, const T* const last) {
+        const size_t offset = it - in;
+        const size_t chunk = offset / chunk_size;
+        T* dest = out + offset;
+        T carry = chunk == 0 ? *it : op(carries[chunk - 1].value, *it);
+        *dest = carry;
+        for (++it, ++dest; it != last; ++it, ++dest) {
+            carry = op(carry, *it);
+            *dest = carry;
+        }
+    });
+}
+
+} // namespace parallel
 
 } // namespace fz
@@ -0,0 +1,79 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstdint>
+#include <vector>
+
+struct alignas(64) PaddedCounter
+{
+    long value;
+};
+
+template<typename T>
+bool is_aligned(const T* const ptr, const size_t alignment)
+{
+    return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+void test_alignment()
+{
+    using AlignedFloats = fz::SafePtr<float, 64>;
+
+    // every constructor
+    AlignedFloats ptr0(100);
+    AlignedFloats ptr1(100, 1.5f);
+    AlignedFloats ptr2 = {1.0f, 2.0f, 3.0f};
+    std::vector<float> vec = {4.0f, 5.0f};
+    AlignedFloats ptr3(vec.begin(), vec.end());
+    auto ptr4 = AlignedFloats::uninitialized(3);
+    ASSERT_TRUE(is_aligned(ptr0.data(), 64));
+    ASSERT_TRUE(is_aligned(ptr1.data(), 64));
+    ASSERT_TRUE(is_aligned(ptr2.data(), 64));
+    ASSERT_TRUE(is_aligned(ptr3.data(), 64));
+    ASSERT_TRUE(is_aligned(ptr4.data(), 64));
+    ASSERT_EQ(ptr1[99], 1.5f);
+    ASSERT_EQ(ptr2[2], 3.0f);
+    ASSERT_EQ(ptr3[1], 5.0f);
+    ASSERT_EQ(ptr1.aligned_data(), ptr1.data());
+
+    // copy
+    auto ptr5 = ptr1;
+    ASSERT_TRUE(is_aligned(ptr5.data(), 64));
+    ASSERT_EQ(ptr5[0], 1.5f);
+    ptr0.free();
+    ptr0 = ptr2;
+    ASSERT_TRUE(is_aligned(ptr0.data(), 64));
+    ASSERT_EQ(ptr0[1], 2.0f);
+
+    // page alignment
+    fz::SafePtr<char, 4096> ptr6(10, 'a');
+    ASSERT_TRUE(is_aligned(ptr6.data(), 4096));
+    ASSERT_EQ(ptr6[9], 'a');
+
+    // over aligned types are aligned by default
+    fz::SafePtr<PaddedCounter> ptr7(8);
+    ASSERT_TRUE(is_aligned(ptr7.data(), 64));
+    ASSERT_TRUE(is_aligned(&ptr7[1], 64));
+
+    // views
+    float* raw = ptr1.data();
+    auto view0 = AlignedFloats::make_view(raw, 16);
+    ASSERT_EQ(view0[0], 1.5f);
+    ASSERT_THROWS(AlignedFloats::make_view(raw + 1, 15));
+    auto view1 = fz::SafePtr<float>::make_view(raw + 1, 15);
+    ASSERT_EQ(view1[0], 1.5f);
+
+    ptr0.free();
+    ptr1.free();
+    ptr2.free();
+    ptr3.free();
+    ptr4.free();
+    ptr5.free();
+    ptr6.free();
+    ptr7.free();
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(ptr1.aligned_data());
+    #endif
+}
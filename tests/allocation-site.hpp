@@ -0,0 +1,122 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Returns the stats of the allocations at `line` of this file, or stats of
+// nothing if there are none.
+inline fz::AllocationSiteStats find_site(const int line)
+{
+    for (const auto& stats : fz::allocation_sites()) {
+        if (stats.site.line == line &&
+            std::strcmp(stats.site.file, __FILE__) == 0
+        ) {
+            return stats;
+        }
+    }
+    return fz::AllocationSiteStats{
+        fz::AllocationSite("none", 0, "none"), "", 0, 0, 0, 0
+    };
+}
+
+struct SiteHolder
+{
+    fz::SafePtr<char> buffer;
+    int line;
+
+    SiteHolder() : buffer(10), line(__LINE__) {}
+};
+
+void test_allocation_site()
+{
+    // the site defaults to the caller
+    const fz::AllocationSite site0; const int line0 = __LINE__;
+    ASSERT_EQ(site0.line, line0);
+    ASSERT_TRUE(std::strcmp(site0.file, __FILE__) == 0);
+    ASSERT_TRUE(std::strcmp(site0.function, "test_allocation_site") == 0);
+
+    #ifdef SAFE_PTR_DEBUG
+        // live memory is counted at the site it was allocated at, per type
+        fz::SafePtr<int> ptr0(100); const int line1 = __LINE__;
+        fz::SafePtr<int> ptr1 = {1, 2, 3}; const int line2 = __LINE__;
+        ASSERT_EQ(find_site(line1).live_count, 1);
+        ASSERT_EQ(find_site(line1).live_bytes, 100 * sizeof(int));
+        ASSERT_EQ(find_site(line1).type, "int");
+        ASSERT_EQ(find_site(line2).live_bytes, 3 * sizeof(int));
+        std::vector<fz::SafePtr<double>> ptrs;
+        ptrs.reserve(5);
+        for (int i = 0; i != 5; ++i) {
+            ptrs.push_back(fz::SafePtr<double>(10)); const int line = __LINE__;
+            ASSERT_EQ(find_site(line).live_count, size_t(i) + 1);
+        }
+
+        // and not anymore after it is freed
+        ptr0.free();
+        ASSERT_EQ(find_site(line1).live_count, 0);
+        ASSERT_EQ(find_site(line1).leaked_count, 0);
+        for (auto& ptr : ptrs) {
+            ptr.free();
+        }
+
+        // copies and resizes are counted at their own site
+        fz::SafePtr<int> ptr2 = ptr1; const int line3 = __LINE__;
+        ptr2.resize(50); const int line4 = __LINE__;
+        ASSERT_EQ(find_site(line3).live_count, 0);
+        ASSERT_EQ(find_site(line4).live_bytes, 50 * sizeof(int));
+        ptr2.free();
+        ASSERT_EQ(find_site(line4).live_count, 0);
+
+        // the site can be given explicitly, e.g. by a wrapper
+        const fz::AllocationSite site1("wrapper.cpp", 7, "make");
+        fz::SafePtr<float> ptr3(4, 1.0f, site1);
+        bool is_found = false;
+        for (const auto& stats : fz::allocation_sites()) {
+            if (std::strcmp(stats.site.file, "wrapper.cpp") == 0) {
+                ASSERT_EQ(stats.site.line, 7);
+                ASSERT_EQ(stats.live_bytes, 4 * sizeof(float));
+                is_found = true;
+            }
+        }
+        ASSERT_TRUE(is_found);
+        ptr3.free();
+
+        // allocations made by a constructor are attributed to its line
+        SiteHolder* holder = new SiteHolder;
+        ASSERT_EQ(find_site(holder->line).live_bytes, 10);
+        ASSERT_TRUE(
+            std::strcmp(find_site(holder->line).site.function, "SiteHolder")
+                == 0
+        );
+
+        // leaks are counted, and reported with their site
+        fz::SafePtr<long>* leaked = new fz::SafePtr<long>(8);
+        const int line5 = __LINE__ - 1;
+        ASSERT_WARNS(delete leaked);
+        ASSERT_EQ(find_site(line5).live_count, 0);
+        ASSERT_EQ(find_site(line5).leaked_count, 1);
+        ASSERT_EQ(find_site(line5).leaked_bytes, 8 * sizeof(long));
+
+        std::ostringstream report;
+        fz::print_allocation_report(report);
+        ASSERT_TRUE(report.str().find("allocation report") != std::string::npos);
+        ASSERT_TRUE(
+            report.str().find(__FILE__ ":" + std::to_string(line5))
+                != std::string::npos
+        );
+        ASSERT_TRUE(report.str().find("by type") != std::string::npos);
+
+        holder->buffer.free();
+        delete holder;
+        ptr1.free();
+    #else
+        // sites are only tracked in debug mode
+        fz::SafePtr<int> ptr0(100);
+        ASSERT_TRUE(fz::allocation_sites().empty());
+        ptr0.free();
+    #endif
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstdint>
+#include <string>
+
+void test_arena()
+{
+    using ArenaInts = fz::SafePtr<int, alignof(int), fz::ArenaAllocator>;
+    using ArenaFloats = fz::SafePtr<float, 64, fz::ArenaAllocator>;
+    using ArenaStrings =
+        fz::SafePtr<std::string, alignof(std::string), fz::ArenaAllocator>;
+
+    // allocating outside of a scope
+    ASSERT_TRUE(fz::Arena::current() == nullptr);
+    ASSERT_THROWS(ArenaInts(4));
+
+    fz::Arena arena(256);
+    {
+        fz::Arena::Scope scope(arena);
+        ASSERT_EQ(fz::Arena::current(), &arena);
+
+        // consecutive allocations come from the same block
+        ArenaInts ptr0 = {1, 2, 3};
+        ArenaInts ptr1(5, 7);
+        ASSERT_EQ(ptr0[2], 3);
+        ASSERT_EQ(ptr1[4], 7);
+        // (records are never in the arena, also in inline header mode)
+        ASSERT_TRUE(ptr1.data() >= ptr0.data() + 3);
+        ASSERT_TRUE(ptr1.data() < ptr0.data() + 64);
+
+        // alignment is honored
+        ArenaFloats ptr2(3, 1.0f);
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(ptr2.data()) % 64, 0);
+
+        // allocations bigger than a block
+        ArenaInts ptr3(1000, 9);
+        ASSERT_EQ(ptr3[999], 9);
+
+        // copies come from the arena as well
+        auto ptr4 = ptr1;
+        ASSERT_EQ(ptr4[0], 7);
+        ASSERT_DIFF(ptr4.data(), ptr1.data());
+
+        // free() destroys the elements, but is optional
+        ArenaStrings ptr5(2, "abc");
+        ASSERT_EQ(ptr5[1], "abc");
+        ptr5.free();
+        #ifdef SAFE_PTR_DEBUG
+            ASSERT_WARNS(ptr5.size());
+            ASSERT_THROWS(ptr5.free());
+        #endif
+
+        // nested scopes
+        fz::Arena inner_arena;
+        {
+            fz::Arena::Scope inner_scope(inner_arena);
+            ASSERT_EQ(fz::Arena::current(), &inner_arena);
+            ArenaInts ptr6(4, 1);
+            ASSERT_EQ(ptr6[3], 1);
+        }
+        ASSERT_EQ(fz::Arena::current(), &arena);
+    }
+    ASSERT_TRUE(fz::Arena::current() == nullptr);
+    arena.reset();
+
+    // the first block is reused after reset()
+    {
+        fz::Arena::Scope scope(arena);
+        ArenaInts ptr7(8, 2);
+        ASSERT_EQ(ptr7[7], 2);
+    }
+
+    // SafePtrs may outlive the memory of a reset or destroyed arena, as
+    // long as they are not used
+    {
+        fz::Arena::Scope scope(arena);
+        ArenaInts ptr8(2, 1);
+        ArenaInts ptr9(1000, 1);
+        arena.reset();
+    }
+    {
+        ArenaInts ptr10;
+        {
+            fz::Arena short_arena;
+            fz::Arena::Scope scope(short_arena);
+            ptr10 = ArenaInts(4, 1);
+            ASSERT_EQ(ptr10[3], 1);
+        }
+    }
+}
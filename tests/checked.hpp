@@ -0,0 +1,81 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <utility>
+#include <vector>
+
+void test_checked()
+{
+    // non const
+    fz::SafePtr<int> ptr0 = {1, 2, 3, 4, 5};
+    auto range0 = ptr0.checked();
+    ASSERT_EQ(range0.size(), 5);
+    ASSERT_EQ(range0.empty(), false);
+    ASSERT_EQ(range0.begin(), ptr0.begin());
+    ASSERT_EQ(range0.end(), ptr0.end());
+    ASSERT_EQ(range0.data(), ptr0.data());
+    ASSERT_EQ(range0[2], 3);
+    ASSERT_EQ(range0.at(4), 5);
+    ASSERT_THROWS(range0.at(5));
+    for (auto& p : ptr0.checked()) {
+        p *= 2;
+    }
+    ASSERT_EQ(ptr0[0], 2);
+    ASSERT_EQ(ptr0[4], 10);
+    range0.check();
+
+    // sub range
+    auto range1 = ptr0.checked(1, 3);
+    ASSERT_EQ(range1.size(), 3);
+    ASSERT_EQ(range1[0], 4);
+    ASSERT_EQ(range1[2], 8);
+    ASSERT_EQ(range1.end(), ptr0.begin() + 4);
+    ASSERT_EQ(ptr0.checked(5, 0).empty(), true);
+    ASSERT_THROWS(ptr0.checked(6, 0));
+    ASSERT_THROWS(ptr0.checked(2, 4));
+    ASSERT_THROWS(ptr0.checked(1, static_cast<size_t>(-1)));
+
+    // const
+    const fz::SafePtr<int> ptr1 = {7, 8, 9};
+    int sum = 0;
+    for (const auto& p : ptr1.checked()) {
+        sum += p;
+    }
+    ASSERT_EQ(sum, 24);
+    ASSERT_EQ(ptr1.checked(1, 2)[1], 9);
+
+    // views
+    std::vector<int> vec = {1, 2, 3};
+    auto vec_view = fz::SafePtr<int>::make_view(vec.data(), vec.size());
+    auto range2 = vec_view.checked();
+    ASSERT_EQ(range2[1], 2);
+    range2.check();
+
+    // ranges outlive the SafePtr they were created from
+    auto* ptr2 = new fz::SafePtr<int>{4, 5};
+    auto range3 = ptr2->checked();
+    fz::SafePtr<int> ptr3 = std::move(*ptr2);
+    delete ptr2;
+    range3.check();
+    ASSERT_EQ(range3[1], 5);
+    auto range4 = range3;
+    auto range5 = std::move(range4);
+    ASSERT_EQ(range5.size(), 2);
+    range4.check();
+    ptr3.free();
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(range3.check());
+        ASSERT_WARNS(range5.check());
+    #endif
+
+    ptr0.free();
+    ptr1.free();
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(ptr0.checked());
+        ASSERT_WARNS(ptr1.checked());
+        ASSERT_WARNS(ptr0.checked(0, 1));
+        ASSERT_WARNS(range0.check());
+    #endif
+}
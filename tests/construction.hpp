@@ -0,0 +1,131 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <string>
+#include <vector>
+
+// Counts how its instances are created and destroyed.
+struct Counted
+{
+    static int default_constructions;
+    static int copy_constructions;
+    static int assignments;
+    static int destructions;
+    static int throw_after; // copy constructions left before one throws
+
+    int value = 0;
+
+    Counted() {
+        ++default_constructions;
+    }
+
+    Counted(const int v) : value(v) {}
+
+    Counted(const Counted& other) : value(other.value) {
+        if (throw_after == 0) {
+            throw std::runtime_error("Counted copy failed");
+        }
+        --throw_after;
+        ++copy_constructions;
+    }
+
+    Counted& operator=(const Counted& other) {
+        ++assignments;
+        value = other.value;
+        return *this;
+    }
+
+    ~Counted() {
+        ++destructions;
+    }
+
+    static void reset() {
+        default_constructions = 0;
+        copy_constructions = 0;
+        assignments = 0;
+        destructions = 0;
+        throw_after = -1;
+    }
+};
+
+int Counted::default_constructions = 0;
+int Counted::copy_constructions = 0;
+int Counted::assignments = 0;
+int Counted::destructions = 0;
+int Counted::throw_after = -1;
+
+void test_construction()
+{
+    // every element is constructed exactly once, in place
+    Counted::reset();
+    const Counted value(3);
+    fz::SafePtr<Counted> ptr0(5, value);
+    ASSERT_EQ(Counted::default_constructions, 0);
+    ASSERT_EQ(Counted::copy_constructions, 5);
+    ASSERT_EQ(Counted::assignments, 0);
+    ASSERT_EQ(ptr0[4].value, 3);
+    ptr0.free();
+    ASSERT_EQ(Counted::destructions, 5);
+
+    Counted::reset();
+    fz::SafePtr<Counted> ptr1(4);
+    ASSERT_EQ(Counted::default_constructions, 4);
+    ASSERT_EQ(Counted::assignments, 0);
+    auto ptr2 = ptr1;
+    ASSERT_EQ(Counted::default_constructions, 4);
+    ASSERT_EQ(Counted::copy_constructions, 4);
+    ASSERT_EQ(Counted::assignments, 0);
+    ptr1.free();
+    ptr2.free();
+    ASSERT_EQ(Counted::destructions, 8);
+
+    Counted::reset();
+    std::vector<Counted> vec(3);
+    fz::SafePtr<Counted> ptr3(vec.begin(), vec.end());
+    fz::SafePtr<Counted> ptr4 = {Counted(1), Counted(2)};
+    ASSERT_EQ(Counted::default_constructions, 3);
+    ASSERT_EQ(Counted::copy_constructions, 5);
+    ASSERT_EQ(Counted::assignments, 0);
+    ASSERT_EQ(ptr4[1].value, 2);
+    ptr3.free();
+    ptr4.free();
+
+    // a throwing element destroys what was already constructed
+    Counted::reset();
+    Counted::throw_after = 2;
+    ASSERT_THROWS(fz::SafePtr<Counted>(4, value));
+    ASSERT_EQ(Counted::copy_constructions, 2);
+    ASSERT_EQ(Counted::destructions, 2);
+
+    Counted::reset();
+    fz::SafePtr<Counted> ptr5 = {Counted(1), Counted(2)};
+    fz::SafePtr<Counted> ptr6(3);
+    ptr6.free();
+    Counted::throw_after = 1;
+    ASSERT_THROWS(ptr6 = ptr5);
+    Counted::reset();
+    ptr6 = ptr5;
+    ASSERT_EQ(ptr6[1].value, 2);
+    ptr5.free();
+    ptr6.free();
+
+    // non trivial standard types
+    fz::SafePtr<std::string> ptr7(3, "abc");
+    ASSERT_EQ(ptr7[2], "abc");
+    auto ptr8 = ptr7;
+    ASSERT_EQ(ptr8[0], "abc");
+    ptr7.free();
+    ptr8.free();
+
+    // uninitialized
+    auto ptr9 = fz::SafePtr<int>::uninitialized(8);
+    ASSERT_EQ(ptr9.size(), 8);
+    ptr9.fill(1);
+    ASSERT_EQ(ptr9[7], 1);
+    ptr9.free();
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(ptr9.size());
+    #endif
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstring>
+
+// 12 bytes, so whole copies do not fit in a SIMD register
+struct Triple
+{
+    float x, y, z;
+};
+
+// 16 bytes, but only aligned to 8
+struct Pair
+{
+    double first;
+    long long second;
+};
+
+template<typename T>
+bool all_bytes_equal(const T* const data, const size_t size, const T& value)
+{
+    for (size_t i = 0; i != size; ++i) {
+        if (std::memcmp(&data[i], &value, sizeof(T)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+void test_fill_copy_of(const T& value)
+{
+    // every size and start address around the vector widths; the elements
+    // around the filled ones must not be written to
+    fz::SafePtr<T> buffer(300);
+    for (size_t offset = 0; offset != 3; ++offset) {
+        for (size_t size = 0; size != 290; ++size) {
+            std::memset(buffer.data(), 0x5a, buffer.size() * sizeof(T));
+            fz::SafePtr<T>::make_view(buffer.data() + offset, size).fill(value);
+            ASSERT_TRUE(all_bytes_equal(buffer.data() + offset, size, value));
+            T canary;
+            std::memset(&canary, 0x5a, sizeof(T));
+            ASSERT_TRUE(all_bytes_equal(buffer.data(), offset, canary));
+            ASSERT_TRUE(all_bytes_equal(
+                buffer.data() + offset + size, 300 - offset - size, canary
+            ));
+        }
+    }
+
+    // copies of every size
+    for (size_t size = 0; size < 290; size += 3) {
+        auto view = fz::SafePtr<T>::make_view(buffer.data(), size);
+        fz::SafePtr<T> copy = view;
+        ASSERT_EQ(copy.size(), size);
+        ASSERT_TRUE(
+            std::memcmp(copy.data(), buffer.data(), size * sizeof(T)) == 0
+        );
+        copy.free();
+    }
+    buffer.free();
+
+    // big enough to be written with non-temporal stores
+    const size_t big_size = SAFE_PTR_STREAMING_THRESHOLD / sizeof(T) + 5;
+    fz::SafePtr<T> big(big_size, value);
+    ASSERT_TRUE(all_bytes_equal(big.data(), big_size, value));
+    big[big_size - 1] = T();
+    fz::SafePtr<T> big_copy = big;
+    ASSERT_TRUE(
+        std::memcmp(big_copy.data(), big.data(), big_size * sizeof(T)) == 0
+    );
+    big_copy.fill(value);
+    ASSERT_TRUE(all_bytes_equal(big_copy.data(), big_size, value));
+    big_copy.free();
+    big.free();
+}
+
+void test_fill_copy()
+{
+    test_fill_copy_of<char>('x');
+    test_fill_copy_of<int>(0);
+    test_fill_copy_of<int>(-1);
+    test_fill_copy_of<int>(0x01020304);
+    test_fill_copy_of<double>(1.5);
+    test_fill_copy_of<Triple>(Triple{1.0f, 2.0f, 3.0f});
+    test_fill_copy_of<Pair>(Pair{0.25, 7});
+
+    // the value may be one of the elements
+    fz::SafePtr<int> ptr = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    ptr.fill(ptr[3]);
+    ASSERT_TRUE(all_bytes_equal(ptr.data(), ptr.size(), 4));
+    ptr.free();
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Like Counted, but safe to create and destroy from several threads.
+struct SharedCounted
+{
+    static std::atomic<int> constructions;
+    static std::atomic<int> destructions;
+    static std::atomic<int> throw_after; // copies left before one throws
+
+    SharedCounted() {
+        ++constructions;
+    }
+
+    SharedCounted(const SharedCounted&) {
+        if (throw_after.fetch_sub(1) == 0) {
+            throw std::runtime_error("SharedCounted copy failed");
+        }
+        ++constructions;
+    }
+
+    ~SharedCounted() {
+        ++destructions;
+    }
+};
+
+std::atomic<int> SharedCounted::constructions(0);
+std::atomic<int> SharedCounted::destructions(0);
+std::atomic<int> SharedCounted::throw_after(-1);
+
+// Keeps the thread that constructed it.
+struct ThreadStamp
+{
+    std::thread::id thread;
+
+    ThreadStamp() {}
+
+    ThreadStamp(const ThreadStamp&) : thread(std::this_thread::get_id()) {}
+
+    ThreadStamp& operator=(const ThreadStamp&) {
+        thread = std::this_thread::get_id();
+        return *this;
+    }
+};
+
+void test_first_touch()
+{
+    // ranges cover every element exactly once
+    const fz::FirstTouch first_touch(3);
+    ASSERT_EQ(first_touch.thread_count(), 3);
+    ASSERT_TRUE(!first_touch.is_interleaved());
+    ASSERT_EQ(first_touch.range(0, 10).first, 0);
+    ASSERT_EQ(first_touch.range(0, 10).second, 3);
+    ASSERT_EQ(first_touch.range(1, 10).second, 6);
+    ASSERT_EQ(first_touch.range(2, 10).second, 10);
+    ASSERT_EQ(first_touch.range(2, 2).first, 1);
+    ASSERT_TRUE(fz::FirstTouch().thread_count() >= 1);
+
+    // construction and fill()
+    fz::SafePtr<double> ptr0(100000, 1.5, first_touch);
+    for (size_t i = 0; i != ptr0.size(); ++i) {
+        ASSERT_EQ(ptr0[i], 1.5);
+    }
+    ptr0.fill(2.5, fz::FirstTouch::interleaved(4));
+    for (size_t i = 0; i != ptr0.size(); ++i) {
+        ASSERT_EQ(ptr0[i], 2.5);
+    }
+    ptr0.free();
+
+    // more threads than elements
+    fz::SafePtr<std::string> ptr1(5, "abc", fz::FirstTouch::interleaved(8));
+    ASSERT_EQ(ptr1[4], "abc");
+    ptr1.fill("de", fz::FirstTouch(8));
+    ASSERT_EQ(ptr1[0], "de");
+    ASSERT_EQ(ptr1[4], "de");
+    ptr1.free();
+
+    // range i is written by the thread that was given index i
+    std::vector<std::thread::id> threads(4);
+    fz::FirstTouch pinned(4);
+    pinned.on_thread_start([&threads](const size_t index) {
+        threads[index] = std::this_thread::get_id();
+    });
+    fz::SafePtr<ThreadStamp> ptr2(1000, ThreadStamp(), pinned);
+    for (size_t i = 0; i != 4; ++i) {
+        ASSERT_TRUE(threads[i] != std::this_thread::get_id());
+        for (size_t j = 0; j != i; ++j) {
+            ASSERT_TRUE(threads[i] != threads[j]);
+        }
+        const auto range = pinned.range(i, ptr2.size());
+        for (size_t j = range.first; j != range.second; ++j) {
+            ASSERT_TRUE(ptr2[j].thread == threads[i]);
+        }
+    }
+    ptr2.fill(ThreadStamp(), pinned);
+    ASSERT_TRUE(ptr2[999].thread == threads[3]);
+    ptr2.free();
+
+    // elements are destroyed when a copy throws
+    const SharedCounted value;
+    for (size_t threads = 1; threads <= 4; ++threads) {
+        SharedCounted::constructions = 0;
+        SharedCounted::destructions = 0;
+        SharedCounted::throw_after = 5000;
+        using Counteds = fz::SafePtr<SharedCounted>;
+        ASSERT_THROWS(
+            Counteds(10000, value, fz::FirstTouch::interleaved(threads))
+        );
+        ASSERT_EQ(
+            SharedCounted::constructions.load(),
+            SharedCounted::destructions.load()
+        );
+    }
+    SharedCounted::throw_after = -1;
+
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(ptr0.fill(0.0, first_touch));
+    #endif
+}
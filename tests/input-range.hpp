@@ -0,0 +1,115 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include "first-touch.hpp"
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <string>
+
+// Input iterator that returns the same SharedCounted at every position.
+struct SharedCountedReader
+{
+    using iterator_category = std::input_iterator_tag;
+    using value_type = SharedCounted;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const SharedCounted*;
+    using reference = const SharedCounted&;
+
+    int index;
+    const SharedCounted* value;
+
+    const SharedCounted& operator*() const {
+        return *value;
+    }
+
+    SharedCountedReader& operator++() {
+        ++index;
+        return *this;
+    }
+
+    bool operator!=(const SharedCountedReader& other) const {
+        return index != other.index;
+    }
+};
+
+void test_input_range()
+{
+    // ranges that can only be read once are read once
+    std::istringstream stream0("1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18");
+    fz::SafePtr<int> ptr0(
+        (std::istream_iterator<int>(stream0)), std::istream_iterator<int>()
+    );
+    ASSERT_EQ(ptr0.size(), 18);
+    ASSERT_EQ(ptr0[0], 1);
+    ASSERT_EQ(ptr0[17], 18);
+    ptr0.free();
+
+    // with size hints that are right, too small and too big
+    const size_t hints[] = {0, 1, 17, 100, 1000};
+    for (const size_t hint : hints) {
+        std::istringstream stream("a bc def ghij klmno pqrstu");
+        fz::SafePtr<std::string> ptr(
+            std::istream_iterator<std::string>(stream),
+            std::istream_iterator<std::string>(),
+            hint
+        );
+        ASSERT_EQ(ptr.size(), 6);
+        ASSERT_EQ(ptr[0], "a");
+        ASSERT_EQ(ptr[5], "pqrstu");
+        ptr.free();
+    }
+    std::ostringstream text;
+    for (int i = 0; i != 1000; ++i) {
+        text << i << ' ';
+    }
+    for (const size_t hint : hints) {
+        std::istringstream stream(text.str());
+        fz::SafePtr<int> ptr(
+            std::istream_iterator<int>(stream),
+            std::istream_iterator<int>(),
+            hint
+        );
+        ASSERT_EQ(ptr.size(), 1000);
+        for (int i = 0; i != 1000; ++i) {
+            ASSERT_EQ(ptr[i], i);
+        }
+        ptr.free();
+    }
+
+    // empty ranges
+    std::istringstream stream1("");
+    fz::SafePtr<int> ptr1(
+        (std::istream_iterator<int>(stream1)), std::istream_iterator<int>()
+    );
+    ASSERT_EQ(ptr1.size(), 0);
+    ptr1.free();
+
+    // ranges that can be read more than once are counted first
+    const std::list<double> list = {1.5, 2.5, 3.5};
+    fz::SafePtr<double> ptr2(list.begin(), list.end(), 1);
+    ASSERT_EQ(ptr2.size(), 3);
+    ASSERT_EQ(ptr2[2], 3.5);
+    ptr2.free();
+
+    // every element is destroyed when a copy throws, also while moving the
+    // elements to bigger storage
+    const SharedCounted value;
+    const int throw_afters[] = {0, 10, 16, 40, 100};
+    for (const int throw_after : throw_afters) {
+        SharedCounted::constructions = 0;
+        SharedCounted::destructions = 0;
+        SharedCounted::throw_after = throw_after;
+        using Counteds = fz::SafePtr<SharedCounted>;
+        ASSERT_THROWS(Counteds(
+            SharedCountedReader{0, &value}, SharedCountedReader{1000, &value}
+        ));
+        ASSERT_EQ(
+            SharedCounted::constructions.load(),
+            SharedCounted::destructions.load()
+        );
+    }
+    SharedCounted::throw_after = -1;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstdint>
+
+void test_large_alloc()
+{
+    #ifdef SAFE_PTR_LARGE_ALLOC_THRESHOLD
+        constexpr size_t huge_page_size = SAFE_PTR_HUGE_PAGE_SIZE;
+        constexpr size_t large_size =
+            SAFE_PTR_LARGE_ALLOC_THRESHOLD / sizeof(double) + 1;
+
+        // large allocations are mapped at huge page boundaries (in inline
+        // header and quarantine modes, that is where the header or the
+        // guard in front of the elements starts instead)
+        fz::SafePtr<double> ptr0(large_size, 2.0);
+        ASSERT_EQ(ptr0[0], 2.0);
+        ASSERT_EQ(ptr0[large_size-1], 2.0);
+        auto ptr1 = ptr0;
+        ASSERT_EQ(ptr1[large_size-1], 2.0);
+        #if !defined(SAFE_PTR_DEBUG_INLINE_HEADER) && \
+            !defined(SAFE_PTR_DEBUG_QUARANTINE)
+            ASSERT_EQ(
+                reinterpret_cast<std::uintptr_t>(ptr0.data()) % huge_page_size,
+                0
+            );
+            ASSERT_EQ(
+                reinterpret_cast<std::uintptr_t>(ptr1.data()) % huge_page_size,
+                0
+            );
+        #endif
+
+        // small allocations are not affected
+        fz::SafePtr<double> ptr2(4, 3.0);
+        ASSERT_EQ(ptr2[3], 3.0);
+
+        // other alignments are still honored
+        fz::SafePtr<float, 4096> ptr3(large_size * 2, 1.0f);
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(ptr3.data()) % 4096, 0);
+
+        ptr0.free();
+        ptr1.free();
+        ptr2.free();
+        ptr3.free();
+        #ifdef SAFE_PTR_DEBUG
+            ASSERT_WARNS(ptr0.size());
+            ASSERT_THROWS(ptr0.free());
+        #endif
+    #endif
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstdio>
+#include <fstream>
+
+struct MappedRecord
+{
+    int id;
+    float value;
+};
+
+struct MappedTriple
+{
+    char bytes[3];
+};
+
+void test_map_file()
+{
+    #if defined(__unix__) || defined(__APPLE__)
+        const char* const path = "safe-ptr-test-map-file.bin";
+        {
+            std::ofstream file(path, std::ios::binary);
+            for (int i = 0; i != 1000; ++i) {
+                const MappedRecord record = {i, i * 0.5f};
+                file.write(
+                    reinterpret_cast<const char*>(&record), sizeof record
+                );
+            }
+        }
+
+        // the size comes from the file
+        auto ptr0 = fz::SafePtr<MappedRecord>::map_file(path);
+        ASSERT_EQ(ptr0.size(), 1000);
+        ASSERT_EQ(ptr0[0].id, 0);
+        ASSERT_EQ(ptr0[999].id, 999);
+        ASSERT_EQ(ptr0[999].value, 499.5f);
+        ptr0.free();
+
+        // writes are carried to the file in read_write mode only
+        auto ptr1 = fz::SafePtr<MappedRecord>::map_file(
+            path, fz::MapMode::copy_on_write
+        );
+        ptr1[1].id = -1;
+        ptr1.free();
+        auto ptr2 = fz::SafePtr<MappedRecord>::map_file(
+            path, fz::MapMode::read_write
+        );
+        ASSERT_EQ(ptr2[1].id, 1);
+        ptr2[1].id = -2;
+        ptr2.free();
+        auto ptr3 = fz::SafePtr<MappedRecord>::map_file(path);
+        ASSERT_EQ(ptr3[1].id, -2);
+        ptr3.free();
+
+        // the file size must be a multiple of the element size
+        using Triples = fz::SafePtr<MappedTriple>;
+        ASSERT_THROWS(Triples::map_file(path));
+        ASSERT_THROWS(fz::SafePtr<int>::map_file("safe-ptr-no-such-file"));
+
+        // empty files
+        { std::ofstream file(path, std::ios::binary); }
+        auto ptr4 = fz::SafePtr<MappedRecord>::map_file(path);
+        ASSERT_EQ(ptr4.size(), 0);
+        ptr4.free();
+
+        #ifdef SAFE_PTR_DEBUG
+            ASSERT_WARNS(ptr3[0]);
+            ASSERT_THROWS(ptr3.free());
+            ASSERT_WARNS(fz::SafePtr<MappedRecord>::map_file(path));
+        #endif
+        std::remove(path);
+    #endif
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <array>
+
+void test_nd_view()
+{
+    // row-major
+    fz::SafePtr<int> storage0(12);
+    for (size_t i = 0; i != storage0.size(); ++i) {
+        storage0[i] = static_cast<int>(i);
+    }
+    fz::SafePtr2D<int> matrix0(storage0, {3, 4});
+    ASSERT_EQ(matrix0.rank(), 2);
+    ASSERT_EQ(matrix0.extent(0), 3);
+    ASSERT_EQ(matrix0.extent(1), 4);
+    ASSERT_EQ(matrix0.size(), 12);
+    ASSERT_EQ(matrix0(0, 0), 0);
+    ASSERT_EQ(matrix0(1, 2), 6);
+    ASSERT_EQ(matrix0(2, 3), 11);
+    matrix0(1, 2) = -6;
+    ASSERT_EQ(storage0[6], -6);
+    auto row0 = matrix0.span(1);
+    ASSERT_EQ(row0.size(), 4);
+    ASSERT_EQ(row0.data(), storage0.data() + 4);
+    ASSERT_EQ(row0[2], -6);
+    ASSERT_THROWS(matrix0.at(3, 0));
+    ASSERT_THROWS(matrix0.at(0, 4));
+    ASSERT_THROWS(matrix0.span(3));
+    ASSERT_EQ(matrix0.at(2, 1), 9);
+
+    // column-major, in three dimensions
+    fz::SafePtrND<int, 3, fz::LayoutLeft> tensor0(storage0, {2, 3, 2});
+    ASSERT_EQ(tensor0(1, 0, 0), 1);
+    ASSERT_EQ(tensor0(0, 1, 0), 2);
+    ASSERT_EQ(tensor0(0, 0, 1), -6);
+    ASSERT_EQ(tensor0(1, 2, 1), 11);
+    auto column0 = tensor0.span(2, 1);
+    ASSERT_EQ(column0.size(), 2);
+    ASSERT_EQ(column0[1], 11);
+
+    // strided, e.g. every other column
+    using Strided = fz::SafePtr2D<int, fz::LayoutStride>;
+    Strided matrix1(storage0, Strided::Mapping({3, 2}, {4, 2}));
+    ASSERT_EQ(matrix1(0, 1), 2);
+    ASSERT_EQ(matrix1(2, 1), 10);
+    ASSERT_THROWS(matrix1.span(0));
+    Strided matrix2(storage0, Strided::Mapping({2, 3}, {1, 4}));
+    ASSERT_EQ(matrix2(1, 2), 9);
+    ASSERT_EQ(matrix2.span(1)[1], 5);
+
+    // the storage must be big enough
+    using Matrix = fz::SafePtr2D<int>;
+    ASSERT_THROWS(Matrix(storage0, {4, 4}));
+    ASSERT_THROWS(Strided(storage0, Strided::Mapping({3, 3}, {5, 1})));
+
+    // spans of an empty contiguous dimension are empty
+    Matrix matrix7(storage0, {3, 0});
+    ASSERT_EQ(matrix7.span(2).size(), 0);
+    ASSERT_THROWS(matrix7.span(3));
+    fz::SafePtr2D<int, fz::LayoutLeft> matrix8(storage0, {0, 3});
+    ASSERT_EQ(matrix8.span(2).size(), 0);
+    ASSERT_THROWS(matrix8.span(3));
+
+    // tiled, with padding at the edges
+    using Tiled = fz::SafePtr2D<int, fz::LayoutTiled<2, 4>>;
+    ASSERT_EQ(Tiled::Mapping({5, 6}).required_size(), 3 * 2 * 2 * 4);
+    fz::SafePtr<int> storage1(48, 0);
+    Tiled matrix3(storage1, {5, 6});
+    ASSERT_EQ(matrix3.tile_count(0), 3);
+    ASSERT_EQ(matrix3.tile_count(1), 2);
+    for (size_t i = 0; i != 5; ++i) {
+        for (size_t j = 0; j != 6; ++j) {
+            matrix3(i, j) = static_cast<int>(10 * i + j);
+        }
+    }
+    auto tile0 = matrix3.tile(1, 1);
+    ASSERT_EQ(tile0.size(), 8);
+    ASSERT_EQ(tile0[0], 24);
+    ASSERT_EQ(tile0[1], 25);
+    ASSERT_EQ(tile0[2], 0); // padding
+    ASSERT_EQ(tile0[4], 34);
+    ASSERT_EQ(matrix3.tile(2, 0)[3], 43);
+    ASSERT_EQ(storage1[8], 4); // (0, 4) starts the second tile
+    ASSERT_THROWS(matrix3.tile(3, 0));
+    ASSERT_THROWS(matrix3.span(0));
+
+    // views of a const SafePtr can only read its elements
+    const fz::SafePtr<int>& const_storage0 = storage0;
+    fz::SafePtr2D<const int> matrix5(const_storage0, {3, 4});
+    static_assert(
+        std::is_same<decltype(matrix5(0, 0)), const int&>::value,
+        "the elements of a view of a const SafePtr can only be read"
+    );
+    ASSERT_EQ(matrix5(2, 1), 9);
+    ASSERT_EQ(matrix5.span(1)[2], -6);
+    ASSERT_EQ(matrix5.data(), storage0.data());
+    ASSERT_THROWS(fz::SafePtr2D<const int>(const_storage0, {4, 4}));
+    auto matrix6 = matrix5;
+    ASSERT_EQ(matrix6.at(2, 1), 9);
+    const fz::SafePtr2D<int>& const_matrix0 = matrix0;
+    static_assert(
+        std::is_same<decltype(const_matrix0(0, 0)), const int&>::value &&
+        std::is_same<
+            decltype(*const_matrix0.span(0).begin()), const int&
+        >::value,
+        "the elements of a const SafePtrND can only be read"
+    );
+    ASSERT_EQ(const_matrix0(2, 1), 9);
+
+    // copies are views of the same elements
+    auto matrix4 = matrix0;
+    matrix4(0, 0) = 100;
+    ASSERT_EQ(matrix0(0, 0), 100);
+    matrix4 = matrix3.size() == 30 ? matrix0 : matrix4;
+    ASSERT_EQ(matrix4.data(), storage0.data());
+
+    #ifdef SAFE_PTR_DEBUG
+        // indices are checked for each dimension
+        ASSERT_THROWS(matrix0(0, 4));
+        ASSERT_THROWS(matrix0(3, 0));
+        ASSERT_THROWS(tensor0(0, 0, 2));
+
+        // and so is use after free
+        storage0.free();
+        ASSERT_WARNS(matrix0(0, 0));
+        ASSERT_WARNS(matrix4.span(0));
+        ASSERT_WARNS(tensor0(0, 0, 0));
+        storage1.free();
+        ASSERT_WARNS(matrix3.tile(0, 0));
+    #else
+        storage0.free();
+        storage1.free();
+    #endif
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+void test_parallel()
+{
+    // every task runs exactly once, also when tasks take different times
+    fz::ThreadPool pool(4);
+    ASSERT_EQ(pool.thread_count(), 4);
+    std::vector<std::atomic<int>> runs(1000);
+    for (auto& count : runs) {
+        count = 0;
+    }
+    pool.run(runs.size(), [&](const size_t task) {
+        if (task < 10) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ++runs[task];
+    });
+    for (const auto& count : runs) {
+        ASSERT_EQ(count.load(), 1);
+    }
+
+    // the first exception is rethrown, and the pool can be used afterwards
+    ASSERT_THROWS(pool.run(100, [](const size_t task) {
+        if (task == 50) {
+            throw std::runtime_error("task failed");
+        }
+    }));
+    std::atomic<int> total(0);
+    pool.run(100, [&](const size_t) {
+        pool.run(3, [&](const size_t) { // runs in the same thread
+            ++total;
+        });
+    });
+    ASSERT_EQ(total.load(), 300);
+
+    // sizes around the chunk size, and empty
+    const size_t chunk_size = SAFE_PTR_PARALLEL_CHUNK_BYTES / sizeof(int);
+    const size_t sizes[] = {
+        0, 1, chunk_size - 1, chunk_size, chunk_size + 1, 5 * chunk_size + 7
+    };
+    for (const size_t size : sizes) {
+        fz::SafePtr<int> input(size, 0);
+        for (size_t i = 0; i != size; ++i) {
+            input[i] = static_cast<int>(i % 7);
+        }
+
+        fz::SafePtr<long long> output(size);
+        fz::parallel::transform(input, output, [](const int value) {
+            return 2LL * value;
+        }, pool);
+        long long sum = 0;
+        for (size_t i = 0; i != size; ++i) {
+            ASSERT_EQ(output[i], 2 * static_cast<long long>(i % 7));
+            sum += input[i];
+        }
+
+        ASSERT_EQ(fz::parallel::reduce(input, 0, pool), sum);
+        ASSERT_EQ(
+            fz::parallel::reduce(input, 10, [](const int a, const int b) {
+                return a > b ? a : b;
+            }, pool),
+            10
+        );
+
+        fz::parallel::inclusive_scan(input, input, std::plus<int>(), pool);
+        long long prefix = 0;
+        for (size_t i = 0; i != size; ++i) {
+            prefix += static_cast<int>(i % 7);
+            ASSERT_EQ(input[i], prefix);
+        }
+
+        fz::parallel::for_each(input, [](int& value) { value = -value; });
+        if (size != 0) {
+            ASSERT_EQ(input[size-1], -prefix);
+        }
+        input.free();
+        output.free();
+    }
+
+    // floating point results do not depend on the number of threads
+    fz::SafePtr<double> values(100000);
+    for (size_t i = 0; i != values.size(); ++i) {
+        values[i] = std::sin(static_cast<double>(i)) * 1e6;
+    }
+    fz::ThreadPool pool1(1);
+    fz::ThreadPool pool3(3);
+    const double sum1 = fz::parallel::reduce(values, 0.0, pool1);
+    ASSERT_TRUE(sum1 == fz::parallel::reduce(values, 0.0, pool3));
+    ASSERT_TRUE(sum1 == fz::parallel::reduce(values, 0.0, pool));
+    fz::SafePtr<double> scan1(values.size());
+    fz::SafePtr<double> scan3(values.size());
+    fz::parallel::inclusive_scan(values, scan1, std::plus<double>(), pool1);
+    fz::parallel::inclusive_scan(values, scan3, std::plus<double>(), pool3);
+    ASSERT_TRUE(std::memcmp(
+        scan1.data(), scan3.data(), values.size() * sizeof(double)
+    ) == 0);
+    ASSERT_TRUE(std::abs(scan1[values.size()-1] - sum1) < 1e-3);
+
+    // the chunks of bools are combined without a data race
+    const size_t flag_count = 64 * SAFE_PTR_PARALLEL_CHUNK_BYTES + 3;
+    fz::SafePtr<bool> flags(flag_count, false);
+    flags[flag_count - 1] = true;
+    ASSERT_EQ(
+        fz::parallel::reduce(flags, false, std::logical_or<bool>(), pool),
+        true
+    );
+    ASSERT_EQ(
+        fz::parallel::reduce(flags, true, std::logical_and<bool>(), pool),
+        false
+    );
+    flags[0] = true;
+    fz::SafePtr<bool> seen(flag_count);
+    fz::parallel::inclusive_scan(flags, seen, std::logical_or<bool>(), pool);
+    ASSERT_EQ(
+        fz::parallel::reduce(seen, true, std::logical_and<bool>(), pool),
+        true
+    );
+    flags.free();
+    seen.free();
+
+    // the sizes must match
+    auto part = scan1.subview(0, 10);
+    ASSERT_THROWS(fz::parallel::transform(values, part, [](double value) {
+        return value;
+    }));
+    scan1.free();
+    scan3.free();
+
+    // views can be used
+    auto half = values.subview(0, values.size() / 2);
+    fz::parallel::for_each(half, [](double& value) { value = 1.0; });
+    ASSERT_EQ(fz::parallel::reduce(half), 50000.0);
+    values.free();
+
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(fz::parallel::reduce(values));
+        ASSERT_WARNS(fz::parallel::for_each(half, [](double&) {}));
+    #endif
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+void test_pool()
+{
+    using PoolInts = fz::SafePtr<int, alignof(int), fz::PoolAllocator>;
+    using PoolDoubles = fz::SafePtr<double, 64, fz::PoolAllocator>;
+
+    // memory freed by a thread is reused by the same thread
+    PoolInts ptr0(16, 1);
+    int* const data0 = ptr0.data();
+    ptr0.free();
+    PoolInts ptr1(13, 2);
+    #if !defined(SAFE_PTR_DEBUG_INLINE_HEADER) && \
+        !defined(SAFE_PTR_DEBUG_QUARANTINE)
+        ASSERT_EQ(ptr1.data(), data0);
+    #endif
+    (void)data0;
+    ASSERT_EQ(ptr1[12], 2);
+
+    // sizes of every class, and bigger ones
+    for (size_t size = 0; size < 2000; size += 7) {
+        PoolInts ptr(size, static_cast<int>(size));
+        if (size != 0) {
+            ASSERT_EQ(ptr[size-1], static_cast<int>(size));
+        }
+        ptr.free();
+    }
+
+    // over aligned allocations
+    PoolDoubles ptr2(4, 1.0);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(ptr2.data()) % 64, 0);
+    ptr2.free();
+
+    // memory freed by other threads goes back to its owner
+    std::vector<PoolInts> ptrs;
+    ptrs.reserve(100); // growing would copy, leaking the old elements
+    for (int i = 0; i != 100; ++i) {
+        ptrs.push_back(PoolInts(8, i));
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i != 4; ++i) {
+        threads.push_back(std::thread([&ptrs, i](){
+            for (size_t j = i; j < ptrs.size(); j += 4) {
+                ptrs[j].free();
+            }
+            PoolInts ptr(8, 0); // from the cache of this thread
+            ptr.free();
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::vector<PoolInts> reused;
+    reused.reserve(100);
+    for (int i = 0; i != 100; ++i) {
+        reused.push_back(PoolInts(8, -i));
+    }
+    for (int i = 0; i != 100; ++i) {
+        ASSERT_EQ(reused[i][7], -i);
+        reused[i].free();
+    }
+
+    ptr1.free();
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(ptr1.size());
+        ASSERT_THROWS(ptr1.free());
+        ASSERT_WARNS(PoolInts(4));
+    #endif
+}
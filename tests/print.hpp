@@ -3,6 +3,152 @@
 #pragma once
 
 #include "assert.hpp"
+#include <climits>
+#include <sstream>
+#include <string>
+#include <thread>
+
+struct Labeled
+{
+    int value;
+};
+
+std::ostream& operator<<(std::ostream& out, const Labeled& labeled)
+{
+    return out << "<" << labeled.value << ">";
+}
+
+template<typename T>
+std::string print_to_string(
+    const fz::SafePtr<T>& ptr, const fz::PrintFormat& format
+) {
+    std::ostringstream out;
+    ptr.print(out, format, "ptr");
+    return out.str();
+}
+
+// Checks what print() writes. Unlike test_print(), it always runs.
+void test_print_format()
+{
+    fz::SafePtr<int> ptr0(0);
+    fz::SafePtr<int> ptr1 = {4,3,2};
+    fz::SafePtr<int> ptr4(30);
+    for (size_t i = 0; i != ptr4.size(); ++i) {
+        ptr4[i] = static_cast<int>(i);
+    }
+
+    // the layouts
+    ASSERT_EQ(print_to_string(ptr0, {}), "ptr: {\n}\n");
+    ASSERT_EQ(
+        print_to_string(ptr1, {}), "ptr: {\n    0: 4,\n    1: 3,\n    2: 2\n}\n"
+    );
+    ASSERT_EQ(
+        print_to_string(ptr1, fz::PrintLayout::compact), "ptr: {4, 3, 2}\n"
+    );
+    ASSERT_EQ(print_to_string(ptr1, fz::PrintLayout::csv), "4,3,2\n");
+    ASSERT_EQ(print_to_string(ptr0, fz::PrintLayout::compact), "ptr: {}\n");
+    ASSERT_EQ(print_to_string(ptr0, fz::PrintLayout::csv), "\n");
+
+    // the elements in the middle are left out
+    ASSERT_EQ(
+        print_to_string(ptr4, {fz::PrintLayout::compact, 2, 1}),
+        "ptr: {0, 1, ..., 29}\n"
+    );
+    ASSERT_EQ(
+        print_to_string(ptr4, {fz::PrintLayout::csv, 0, 3}), "...,27,28,29\n"
+    );
+    ASSERT_EQ(
+        print_to_string(ptr4, {fz::PrintLayout::lines, 1, 1}),
+        "ptr: {\n    0: 0,\n    ...\n    29: 29\n}\n"
+    );
+    ASSERT_EQ(
+        print_to_string(ptr4, {fz::PrintLayout::lines, 0, 0}),
+        "ptr: {\n    ...\n}\n"
+    );
+    // but not when only one would be
+    ASSERT_EQ(
+        print_to_string(ptr1, {fz::PrintLayout::csv, 1, 1}), "4,3,2\n"
+    );
+    ASSERT_EQ(
+        print_to_string(ptr4, fz::PrintFormat::all(fz::PrintLayout::csv))
+            .size(),
+        80
+    );
+
+    // the elements are written like std::ostream would with the default
+    // flags, whatever the flags of the stream are
+    const fz::SafePtr<long long> ptr5 = {0, -7, 1234567890123, LLONG_MIN};
+    ASSERT_EQ(
+        print_to_string(ptr5, fz::PrintLayout::csv),
+        "0,-7,1234567890123,-9223372036854775808\n"
+    );
+    const fz::SafePtr<unsigned long long> ptr6 = {ULLONG_MAX, 100, 99, 10};
+    ASSERT_EQ(
+        print_to_string(ptr6, fz::PrintLayout::csv),
+        "18446744073709551615,100,99,10\n"
+    );
+    const fz::SafePtr<double> ptr7 = {1.5, -0.1, 1e20, 1.0/3.0, 0.0};
+    std::ostringstream expected;
+    expected << ptr7[0] << ',' << ptr7[1] << ',' << ptr7[2] << ','
+             << ptr7[3] << ',' << ptr7[4] << '\n';
+    std::ostringstream fixed_out;
+    fixed_out << std::fixed;
+    ptr7.print(fixed_out, fz::PrintLayout::csv);
+    ASSERT_EQ(fixed_out.str(), expected.str());
+    const fz::SafePtr<char> ptr8 = {'a', 'b'};
+    const fz::SafePtr<bool> ptr9 = {true, false};
+    const fz::SafePtr<Labeled> ptr10 = {{1}, {-2}};
+    ASSERT_EQ(print_to_string(ptr8, fz::PrintLayout::csv), "a,b\n");
+    ASSERT_EQ(print_to_string(ptr9, fz::PrintLayout::csv), "1,0\n");
+    ASSERT_EQ(print_to_string(ptr10, fz::PrintLayout::csv), "<1>,<-2>\n");
+
+    // prints from different threads do not interleave
+    std::ostringstream shared;
+    const std::string line = print_to_string(ptr4, fz::PrintFormat::all());
+    std::thread printer([&](){
+        for (int i = 0; i != 50; ++i) {
+            ptr4.print(shared, fz::PrintFormat::all(), "ptr");
+        }
+    });
+    for (int i = 0; i != 50; ++i) {
+        ptr4.print(shared, fz::PrintFormat::all(), "ptr");
+    }
+    printer.join();
+    std::string all_lines;
+    for (int i = 0; i != 100; ++i) {
+        all_lines += line;
+    }
+    ASSERT_EQ(shared.str(), all_lines);
+
+    #if defined(__unix__) || defined(__APPLE__)
+        int pipe_fds[2];
+        ASSERT_EQ(pipe(pipe_fds), 0);
+        ptr1.print(pipe_fds[1], fz::PrintLayout::compact, "fd");
+        close(pipe_fds[1]);
+        char text[32] = {};
+        const ssize_t length = read(pipe_fds[0], text, sizeof(text) - 1);
+        ASSERT_EQ(length, 14);
+        close(pipe_fds[0]);
+        ASSERT_EQ(std::string(text), "fd: {4, 3, 2}\n");
+    #endif
+
+    #ifdef SAFE_PTR_DEBUG
+        fz::SafePtr<int> ptr11 = {1};
+        ptr11.free();
+        ASSERT_WARNS(ptr11.print());
+    #endif
+
+    // free memory
+    ptr0.free();
+    ptr1.free();
+    ptr4.free();
+    ptr5.free();
+    ptr6.free();
+    ptr7.free();
+    ptr8.free();
+    ptr9.free();
+    ptr10.free();
+}
 
 void test_print()
 {
@@ -40,4 +186,4 @@ void test_print()
     ptr4.free();
 
     std::cout << "\033[34m========== PRINT TEST END ==========\033[0m\n";
-}
\ No newline at end of file
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <vector>
+
+void test_quarantine()
+{
+    #ifdef SAFE_PTR_DEBUG_QUARANTINE
+        // blocks freed before are not counted below
+        fz::flush_quarantine();
+
+        // writing past the end or before the beginning is caught by free()
+        fz::SafePtr<int> a(4, 1);
+        int* raw_a = a.data();
+        raw_a[4] = 7;
+        ASSERT_WARNS(a.free());
+        #ifndef SAFE_PTR_DEBUG_INLINE_HEADER
+            // (not in inline header mode, where the header is right before
+            // the elements)
+            fz::SafePtr<double, 64> b(4, 1.0);
+            double* raw_b = b.data();
+            raw_b[-1] = 7.0;
+            ASSERT_WARNS(b.free());
+        #endif
+
+        // freed memory is poisoned and kept, so stale raw pointers read
+        // the poison instead of recycled memory
+        const auto write_after_free = [](){
+            fz::SafePtr<unsigned char> c(8, 1);
+            unsigned char* raw_c = c.data();
+            c.free();
+            ASSERT_EQ(raw_c[0], 0xDD);
+            ASSERT_EQ(raw_c[7], 0xDD);
+            raw_c[3] = 1;
+        };
+        #ifdef SAFE_PTR_DEBUG_INLINE_HEADER
+            // writes after free() are found when the last SafePtr holding
+            // the header is destroyed
+            ASSERT_WARNS(write_after_free());
+        #else
+            // writes after free() are found when the memory leaves the
+            // quarantine
+            write_after_free();
+            const size_t written_count = fz::flush_quarantine();
+            ASSERT_EQ(written_count, 1);
+
+            // or when newer memory pushes it out
+            fz::SafePtr<char> d(16, 'x');
+            char* raw_d = d.data();
+            d.free();
+            raw_d[0] = 'y';
+            bool warned = false;
+            for (size_t i = 0; i != SAFE_PTR_DEBUG_QUARANTINE_COUNT; ++i) {
+                fz::SafePtr<char> e(16, 'x');
+                try {
+                    e.free();
+                } catch (const fz::_SafePtrWarning&) {
+                    warned = true;
+                }
+            }
+            ASSERT_TRUE(warned);
+        #endif
+
+        // untouched memory passes, also from other allocators
+        fz::SafePtr<float, 4, fz::PoolAllocator> f(100, 1.0f);
+        f.resize(1000);
+        ASSERT_EQ(f[99], 1.0f);
+        f.free();
+        std::vector<fz::SafePtr<int>> g;
+        g.reserve(100);
+        for (int i = 0; i != 100; ++i) {
+            g.emplace_back(i, i);
+        }
+        for (auto& ptr : g) {
+            ptr.free();
+        }
+        ASSERT_EQ(fz::flush_quarantine(), 0);
+    #else
+        // nothing is kept
+        ASSERT_EQ(fz::flush_quarantine(), 0);
+    #endif
+}
@@ -5,6 +5,14 @@
 #include "assert.hpp"
 #include <thread>
 #include <vector>
+#include <atomic>
+
+// Destroyed at exit, after the statics that are made after it, so its record
+// must still be found then. Sampled builds do not run test_ref_count(),
+// which frees it.
+#ifndef SAFE_PTR_DEBUG_SAMPLE_RATE
+    fz::SafePtr<int> static_ptr(4, 1);
+#endif
 
 void test_ref_count()
 {
@@ -42,4 +50,46 @@ void test_ref_count()
         t1[i].join();
     }  
     b.free();
+
+    #ifdef SAFE_PTR_DEBUG
+        // only one of many concurrent free() calls may succeed
+        fz::SafePtr<float> c = {1,2,3,4};
+        std::atomic<size_t> successful_frees(0);
+        std::vector<std::thread> t2;
+        for (size_t i=0; i!=thread_count; ++i) {
+            t2.push_back(std::thread([&](){
+                try {
+                    c.free();
+                    ++successful_frees;
+                } catch (const std::logic_error&) {}
+            }));
+        }
+        for (size_t i=0; i!=thread_count; ++i) {
+            t2[i].join();
+        }
+        ASSERT_EQ(successful_frees.load(), 1);
+
+        // memory ids are reused, but not while a SafePtr still holds them
+        fz::SafePtr<float> d = {1,2,3,4};
+        d.free();
+        std::vector<fz::SafePtr<float>> e;
+        e.reserve(1000);
+        for (size_t i=0; i!=100000; ++i) {
+            fz::SafePtr<float> f(4, 1.0f);
+            f.free();
+            if (i % 100 == 0) {
+                e.emplace_back(4, float(i));
+            }
+        }
+        ASSERT_WARNS(d[0]);
+        for (size_t i=0; i!=e.size(); ++i) {
+            ASSERT_EQ(e[i][3], float(i * 100));
+            e[i].free();
+        }
+    #endif
+
+    #ifndef SAFE_PTR_DEBUG_SAMPLE_RATE
+        ASSERT_EQ(static_ptr[3], 1);
+        static_ptr.free();
+    #endif
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include "construction.hpp"
+#include <string>
+
+void test_resize()
+{
+    // assign() reuses the memory when the sizes match
+    fz::SafePtr<int> ptr0 = {1, 2, 3};
+    const fz::SafePtr<int> ptr1 = {4, 5, 6};
+    int* const data0 = ptr0.data();
+    ptr0.assign(ptr1);
+    ASSERT_EQ(ptr0.data(), data0);
+    ASSERT_EQ(ptr0[2], 6);
+    ptr0.assign(ptr0);
+    ASSERT_EQ(ptr0[0], 4);
+
+    // and allocates new memory when they do not
+    const fz::SafePtr<int> ptr2 = {7, 8, 9, 10, 11};
+    ptr0.assign(ptr2);
+    ASSERT_EQ(ptr0.size(), 5);
+    ASSERT_EQ(ptr0[4], 11);
+    fz::SafePtr<int> ptr3;
+    ptr3.assign(ptr2);
+    ASSERT_EQ(ptr3.size(), 5);
+    ASSERT_EQ(ptr3[0], 7);
+
+    // resize() keeps the first elements
+    ptr3.resize(8, -1);
+    ASSERT_EQ(ptr3.size(), 8);
+    ASSERT_EQ(ptr3[4], 11);
+    ASSERT_EQ(ptr3[5], -1);
+    ASSERT_EQ(ptr3[7], -1);
+    ptr3.resize(2);
+    ASSERT_EQ(ptr3.size(), 2);
+    ASSERT_EQ(ptr3[1], 8);
+    ptr3.resize(0);
+    ASSERT_EQ(ptr3.size(), 0);
+    fz::SafePtr<int> ptr4;
+    ptr4.resize(3, 5);
+    ASSERT_EQ(ptr4[2], 5);
+
+    // elements that are not trivially relocatable are moved
+    fz::SafePtr<std::string> ptr5(2, "abc");
+    ptr5.resize(40, "de");
+    ASSERT_EQ(ptr5[1], "abc");
+    ASSERT_EQ(ptr5[39], "de");
+    ptr5.resize(1);
+    ASSERT_EQ(ptr5.size(), 1);
+    ASSERT_EQ(ptr5[0], "abc");
+
+    // every element is constructed and destroyed exactly once
+    Counted::reset();
+    fz::SafePtr<Counted> ptr6(3, Counted(1));
+    ptr6.resize(6);
+    ASSERT_EQ(Counted::default_constructions, 3);
+    ASSERT_EQ(ptr6[2].value, 1);
+    ptr6.resize(2);
+    ptr6.free();
+    ASSERT_EQ(
+        Counted::default_constructions + Counted::copy_constructions,
+        Counted::destructions - 1 // the temporary Counted(1)
+    );
+
+    // nothing changes when constructing a new element throws
+    Counted::reset();
+    fz::SafePtr<Counted> ptr7(2, Counted(2));
+    Counted::throw_after = 3;
+    ASSERT_THROWS(ptr7.resize(10, Counted(3)));
+    ASSERT_EQ(ptr7.size(), 2);
+    ASSERT_EQ(ptr7[1].value, 2);
+    ptr7.free();
+    ASSERT_EQ(
+        Counted::default_constructions + Counted::copy_constructions,
+        Counted::destructions - 2 // the temporaries
+    );
+    Counted::reset();
+
+    // the pool resizes in place within a size class
+    using PoolInts = fz::SafePtr<int, alignof(int), fz::PoolAllocator>;
+    PoolInts ptr8(5, 1);
+    int* const data8 = ptr8.data();
+    ptr8.resize(7, 2);
+    #if !defined(SAFE_PTR_DEBUG_INLINE_HEADER) && \
+        !defined(SAFE_PTR_DEBUG_QUARANTINE)
+        ASSERT_EQ(ptr8.data(), data8);
+    #endif
+    (void)data8;
+    ASSERT_EQ(ptr8[4], 1);
+    ASSERT_EQ(ptr8[6], 2);
+    ptr8.resize(1000, 3);
+    ASSERT_EQ(ptr8[6], 2);
+    ASSERT_EQ(ptr8[999], 3);
+    ptr8.free();
+
+    // large mappings are remapped
+    #ifdef SAFE_PTR_LARGE_ALLOC_THRESHOLD
+        constexpr size_t large_size =
+            SAFE_PTR_LARGE_ALLOC_THRESHOLD / sizeof(double) + 1;
+        fz::SafePtr<double> ptr9(large_size, 1.0);
+        ptr9.resize(large_size * 3, 2.0);
+        ASSERT_EQ(ptr9[large_size-1], 1.0);
+        ASSERT_EQ(ptr9[large_size], 2.0);
+        ASSERT_EQ(ptr9[large_size*3-1], 2.0);
+        ptr9.resize(large_size);
+        ASSERT_EQ(ptr9[large_size-1], 1.0);
+        ptr9.free();
+    #endif
+
+    #ifdef SAFE_PTR_DEBUG
+        // other SafePtrs to the old memory can not be used anymore
+        fz::SafePtr<int> ptr10(4, 1);
+        fz::SafePtr<int> ptr11 = std::move(ptr10);
+        ptr11.resize(100);
+        ASSERT_WARNS(ptr10[0]);
+        ASSERT_EQ(ptr11[3], 1);
+        ptr11.free();
+        // reusing freed memory throws instead of touching it
+        size_t reuse_errors = 0;
+        fz::SafePtr<int> ptr12(100, 2);
+        try {
+            ptr11.resize(100000);
+        } catch (const std::logic_error&) {
+            ++reuse_errors;
+        }
+        try {
+            ptr11.assign(ptr12); // same size
+        } catch (const std::logic_error&) {
+            ++reuse_errors;
+        }
+        try {
+            ptr11.assign(ptr2);
+        } catch (const std::logic_error&) {
+            ++reuse_errors;
+        }
+        ASSERT_EQ(reuse_errors, 3);
+        ptr12.free();
+        ASSERT_THROWS(
+            fz::SafePtr<int>::make_view(ptr0.data(), 2).resize(4)
+        );
+    #endif
+
+    ptr0.free();
+    ptr1.free();
+    ptr2.free();
+    ptr3.free();
+    ptr4.free();
+    ptr5.free();
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstring>
+#include <vector>
+
+void test_sampling()
+{
+    #if defined(SAFE_PTR_DEBUG) && defined(SAFE_PTR_DEBUG_SAMPLE_RATE)
+        // about one in SAFE_PTR_DEBUG_SAMPLE_RATE allocations is tracked
+        constexpr size_t count = 1000;
+        constexpr size_t expected = count / SAFE_PTR_DEBUG_SAMPLE_RATE;
+        std::vector<fz::SafePtr<int>> ptrs;
+        ptrs.reserve(count);
+        for (size_t i = 0; i != count; ++i) {
+            ptrs.push_back(fz::SafePtr<int>(4, static_cast<int>(i)));
+        }
+        size_t sampled = 0;
+        for (const auto& stats : fz::allocation_sites()) {
+            if (std::strcmp(stats.site.file, __FILE__) == 0) {
+                sampled += stats.live_count;
+            }
+        }
+        ASSERT_TRUE(sampled >= expected / 2 && sampled <= expected * 2);
+
+        // the others work like in release mode
+        for (auto& ptr : ptrs) {
+            fz::SafePtr<int> view = ptr.subview(1, 2);
+            ASSERT_EQ(view[1], ptr[2]);
+            ASSERT_THROWS(view.free());
+            ptr.resize(8, 7);
+            ASSERT_EQ(ptr[3], ptr[0]);
+            ASSERT_EQ(ptr[7], 7);
+            fz::SafePtr<int> copy = ptr;
+            ASSERT_EQ(copy[7], 7);
+            copy.free();
+        }
+
+        // and only the tracked ones are checked
+        size_t warnings = 0;
+        for (auto& ptr : ptrs) {
+            ptr.free();
+            try {
+                ptr.size();
+            } catch (const fz::_SafePtrWarning&) {
+                ++warnings;
+            }
+        }
+        ASSERT_TRUE(warnings >= expected / 2 && warnings <= expected * 2);
+        size_t leaks = 0;
+        for (size_t i = 0; i != count; ++i) {
+            try {
+                fz::SafePtr<char> leaked(1);
+            } catch (const fz::_SafePtrWarning&) {
+                ++leaks;
+            }
+        }
+        ASSERT_TRUE(leaks >= expected / 2 && leaks <= expected * 2);
+    #endif
+}
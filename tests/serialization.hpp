@@ -0,0 +1,149 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include "map-file.hpp"
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+void test_serialization()
+{
+    #if defined(__unix__) || defined(__APPLE__)
+        const char* const path = "safe-ptr-test-serialization.bin";
+
+        // the elements and the size come back from the file
+        fz::SafePtr<MappedRecord> ptr0(1000);
+        for (int i = 0; i != 1000; ++i) {
+            ptr0[i] = MappedRecord{i, i * 0.5f};
+        }
+        ptr0.save(path);
+        auto ptr1 = fz::SafePtr<MappedRecord>::load(path);
+        ASSERT_EQ(ptr1.size(), 1000);
+        ASSERT_EQ(ptr1[0].id, 0);
+        ASSERT_EQ(ptr1[999].id, 999);
+        ASSERT_EQ(ptr1[999].value, 499.5f);
+        ptr1.free();
+
+        // the alignment and the allocator do not have to match
+        using PoolRecords = fz::SafePtr<MappedRecord, 64, fz::PoolAllocator>;
+        auto ptr2 = PoolRecords::load(path);
+        ASSERT_EQ(ptr2.size(), 1000);
+        ASSERT_EQ(ptr2[500].id, 500);
+        ptr2.free();
+
+        // empty SafePtrs
+        fz::SafePtr<double> ptr3(0);
+        ptr3.save(path);
+        auto ptr4 = fz::SafePtr<double>::load(path);
+        ASSERT_EQ(ptr4.size(), 0);
+        ptr4.free();
+        ptr3.free();
+
+        // many SafePtrs, also loaded into views
+        fz::SafePtr<int> ints = {1, 2, 3, 4, 5, 6, 7};
+        const fz::SafePtr<char> chars = {'a', 'b', 'c'};
+        {
+            const int fd = open(path, O_WRONLY | O_TRUNC);
+            fz::save_all(fd, ints, chars, ptr0);
+            close(fd);
+        }
+        {
+            fz::SafePtr<int> loaded_ints(10, 0);
+            auto view = loaded_ints.subview(2, 7);
+            fz::SafePtr<char> loaded_chars(3);
+            fz::SafePtr<MappedRecord> loaded_records(1000);
+            const int fd = open(path, O_RDONLY);
+            fz::load_all(fd, view, loaded_chars, loaded_records);
+            close(fd);
+            ASSERT_EQ(loaded_ints[1], 0);
+            ASSERT_EQ(loaded_ints[2], 1);
+            ASSERT_EQ(loaded_ints[8], 7);
+            ASSERT_EQ(loaded_ints[9], 0);
+            ASSERT_EQ(loaded_chars[2], 'c');
+            ASSERT_EQ(loaded_records[999].id, 999);
+            loaded_ints.free();
+            loaded_chars.free();
+            loaded_records.free();
+        }
+        {
+            // the ones saved together can also be loaded one by one
+            const int fd = open(path, O_RDONLY);
+            auto loaded_ints = fz::SafePtr<int>::load(fd);
+            auto loaded_chars = fz::SafePtr<char>::load(fd);
+            auto loaded_records = fz::SafePtr<MappedRecord>::load(fd);
+            close(fd);
+            ASSERT_EQ(loaded_ints.size(), 7);
+            ASSERT_EQ(loaded_chars[0], 'a');
+            ASSERT_EQ(loaded_records[1].value, 0.5f);
+            loaded_ints.free();
+            loaded_chars.free();
+            loaded_records.free();
+        }
+
+        // the sizes must match
+        ASSERT_THROWS(fz::SafePtr<double>::load(path));
+        {
+            fz::SafePtr<int> loaded_ints(6);
+            const int fd = open(path, O_RDONLY);
+            ASSERT_THROWS(fz::load_all(fd, loaded_ints));
+            close(fd);
+            loaded_ints.free();
+        }
+
+        // the data must have been written by save() and not be corrupted
+        ptr0.save(path);
+        {
+            std::fstream file(
+                path, std::ios::in | std::ios::out | std::ios::binary
+            );
+            file.seekp(100);
+            file.put('x');
+        }
+        ASSERT_THROWS(fz::SafePtr<MappedRecord>::load(path));
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "not a SafePtr, but long enough for a header";
+        }
+        ASSERT_THROWS(fz::SafePtr<char>::load(path));
+        ptr0.save(path);
+        ASSERT_EQ(truncate(path, 1000), 0);
+        ASSERT_THROWS(fz::SafePtr<MappedRecord>::load(path));
+        ASSERT_EQ(truncate(path, 10), 0);
+        ASSERT_THROWS(fz::SafePtr<MappedRecord>::load(path));
+        std::remove(path);
+        ASSERT_THROWS(fz::SafePtr<MappedRecord>::load(path));
+
+        // pipes, with more data than fits in their buffer
+        fz::SafePtr<double> ptr5(1 << 20);
+        for (size_t i = 0; i != ptr5.size(); ++i) {
+            ptr5[i] = i * 0.25;
+        }
+        int pipe_fds[2];
+        ASSERT_EQ(pipe(pipe_fds), 0);
+        std::thread writer([&](){
+            fz::save_all(pipe_fds[1], ints, ptr5);
+            close(pipe_fds[1]);
+        });
+        auto ptr6 = fz::SafePtr<int>::load(pipe_fds[0]);
+        auto ptr7 = fz::SafePtr<double>::load(pipe_fds[0]);
+        writer.join();
+        ASSERT_THROWS(fz::SafePtr<double>::load(pipe_fds[0]));
+        close(pipe_fds[0]);
+        ASSERT_EQ(ptr6[6], 7);
+        ASSERT_EQ(ptr7.size(), ptr5.size());
+        ASSERT_EQ(ptr7[(1 << 20) - 1], ((1 << 20) - 1) * 0.25);
+        ptr5.free();
+        ptr6.free();
+        ptr7.free();
+
+        #ifdef SAFE_PTR_DEBUG
+            ASSERT_WARNS(ptr1.save(path));
+            std::remove(path);
+        #endif
+        ptr0.free();
+        ints.free();
+        chars.free();
+    #endif
+}
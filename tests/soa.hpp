@@ -0,0 +1,81 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+void test_soa()
+{
+    // rows are accessed through references to their fields
+    fz::SafeSoA<double, int, char> soa0(100, 1.5, 2, 'a');
+    ASSERT_EQ(soa0.size(), 100);
+    ASSERT_TRUE(!soa0.empty());
+    ASSERT_EQ(std::get<0>(soa0[99]), 1.5);
+    ASSERT_EQ(std::get<1>(soa0[0]), 2);
+    ASSERT_EQ(std::get<2>(soa0[50]), 'a');
+    soa0[3] = std::make_tuple(3.5, 4, 'b');
+    ASSERT_EQ(soa0.get<0>(3), 3.5);
+    ASSERT_EQ(soa0.get<1>(3), 4);
+    ASSERT_EQ(soa0.get<2>(3), 'b');
+    soa0.get<1>(4) = 5;
+    const std::tuple<double, int, char> row = soa0[4];
+    ASSERT_EQ(std::get<1>(row), 5);
+    ASSERT_THROWS(soa0.at(100));
+    ASSERT_EQ(std::get<2>(soa0.at(99)), 'a');
+
+    // each field is a contiguous column, aligned to a cache line
+    auto column0 = soa0.column<1>();
+    ASSERT_EQ(column0.size(), 100);
+    ASSERT_EQ(column0[3], 4);
+    ASSERT_EQ(&column0[4], &soa0.get<1>(4));
+    int sum = 0;
+    for (const int value : column0) {
+        sum += value;
+    }
+    ASSERT_EQ(sum, 98 * 2 + 4 + 5);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(column0.data()) % 64, 0);
+    auto column1 = soa0.column<2>();
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(column1.data()) % 64, 0);
+    ASSERT_EQ(column1[3], 'b');
+    const fz::SafeSoA<double, int, char>& const_soa0 = soa0;
+    auto column2 = const_soa0.column<1>();
+    static_assert(
+        std::is_same<decltype(column2[0]), const int&>::value,
+        "the columns of a const SafeSoA can only be read"
+    );
+    ASSERT_EQ(column2.data(), column0.data());
+    ASSERT_EQ(column2.size(), 100);
+
+    // copies are deep and moves share the memory
+    auto soa1 = soa0;
+    soa1.get<0>(0) = -1.0;
+    ASSERT_EQ(soa0.get<0>(0), 1.5);
+    ASSERT_EQ(soa1.get<1>(3), 4);
+    auto soa2 = std::move(soa1);
+    ASSERT_EQ(soa2.get<0>(0), -1.0);
+    soa2.fill(0.0, 0, 'z');
+    ASSERT_EQ(soa2.get<2>(99), 'z');
+    soa2.free();
+
+    // empty
+    fz::SafeSoA<float> soa3(0);
+    ASSERT_EQ(soa3.size(), 0);
+    ASSERT_EQ(soa3.column<0>().size(), 0);
+    soa3.free();
+
+    #ifdef SAFE_PTR_DEBUG
+        ASSERT_WARNS(soa2.get<0>(0));
+        ASSERT_WARNS(soa1[0]);
+        ASSERT_WARNS(soa1.column<1>());
+        ASSERT_THROWS(soa2.free());
+        column0.check();
+        soa0.free();
+        ASSERT_WARNS(column0.check());
+        ASSERT_WARNS(soa0.size());
+    #else
+        soa0.free();
+    #endif
+}
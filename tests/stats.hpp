@@ -0,0 +1,90 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+// Only allocated by test_stats(), so its counts are known.
+struct StatsRecord
+{
+    char bytes[24];
+};
+
+inline fz::SafePtrTypeStats find_stats_type(const fz::SafePtrStats& stats) {
+    for (const auto& type : stats.types) {
+        if (type.type.find("StatsRecord") != std::string::npos) {
+            return type;
+        }
+    }
+    return fz::SafePtrTypeStats{"none", 0, 0, 0, 0};
+}
+
+void test_stats()
+{
+    #ifdef SAFE_PTR_STATS
+        // allocations are counted in total and for their element type
+        const fz::SafePtrStats stats0 = fz::safe_ptr_stats();
+        fz::SafePtr<StatsRecord> ptr0(100);
+        const fz::SafePtrStats stats1 = fz::safe_ptr_stats();
+        ASSERT_EQ(stats1.allocations, stats0.allocations + 1);
+        ASSERT_EQ(stats1.live_count, stats0.live_count + 1);
+        ASSERT_EQ(stats1.live_bytes, stats0.live_bytes + 2400);
+        ASSERT_EQ(stats1.size_histogram[12], stats0.size_histogram[12] + 1);
+        ASSERT_TRUE(stats1.peak_bytes >= stats1.live_bytes);
+        ASSERT_EQ(find_stats_type(stats1).allocations, 1);
+        ASSERT_EQ(find_stats_type(stats1).live_bytes, 2400);
+
+        // resizing moves the elements to a new allocation
+        ptr0.resize(200);
+        const fz::SafePtrStats stats2 = fz::safe_ptr_stats();
+        ASSERT_EQ(find_stats_type(stats2).allocations, 2);
+        ASSERT_EQ(find_stats_type(stats2).frees, 1);
+        ASSERT_EQ(find_stats_type(stats2).live_count, 1);
+        ASSERT_EQ(find_stats_type(stats2).live_bytes, 4800);
+
+        // and so are frees
+        ptr0.free();
+        const fz::SafePtrStats stats3 = fz::safe_ptr_stats();
+        ASSERT_EQ(stats3.frees, stats2.frees + 1);
+        ASSERT_EQ(stats3.live_bytes, stats0.live_bytes);
+        ASSERT_EQ(find_stats_type(stats3).live_count, 0);
+        ASSERT_EQ(find_stats_type(stats3).live_bytes, 0);
+
+        // also of other threads, after they exit
+        std::vector<std::thread> threads;
+        for (int i = 0; i != 4; ++i) {
+            threads.emplace_back([](){
+                for (int j = 0; j != 1000; ++j) {
+                    fz::SafePtr<StatsRecord> ptr(1);
+                    ptr.free();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        fz::SafePtr<StatsRecord> ptr1;
+        std::thread([&](){ ptr1 = fz::SafePtr<StatsRecord>(10); }).join();
+        const fz::SafePtrStats stats4 = fz::safe_ptr_stats();
+        ASSERT_EQ(find_stats_type(stats4).allocations, 4003);
+        ASSERT_EQ(find_stats_type(stats4).frees, 4002);
+        ASSERT_EQ(find_stats_type(stats4).live_bytes, 240);
+        ptr1.free();
+        ASSERT_EQ(find_stats_type(fz::safe_ptr_stats()).live_count, 0);
+
+        // large allocations raise the peak right away (less what other
+        // threads did not add to it yet)
+        fz::SafePtr<char> ptr2(1 << 22);
+        ptr2.free();
+        ASSERT_TRUE(fz::safe_ptr_stats().peak_bytes >= (1 << 21));
+    #else
+        // nothing is counted
+        fz::SafePtr<StatsRecord> ptr0(100);
+        ASSERT_EQ(fz::safe_ptr_stats().allocations, 0);
+        ASSERT_TRUE(fz::safe_ptr_stats().types.empty());
+        ptr0.free();
+    #endif
+}
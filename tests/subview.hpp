@@ -0,0 +1,99 @@
+// Copyright (c) 2025 Matheus Machado Fiuza <matheusmachadofiuza@gmail.com>
+
+#pragma once
+
+#include "assert.hpp"
+#include <string>
+#include <type_traits>
+
+void test_subview()
+{
+    // subviews point into the memory, without copying it
+    fz::SafePtr<int> ptr0 = {1, 2, 3, 4, 5, 6};
+    auto view0 = ptr0.subview(2, 3);
+    ASSERT_EQ(view0.size(), 3);
+    ASSERT_EQ(view0.data(), ptr0.data() + 2);
+    ASSERT_EQ(view0[0], 3);
+    view0[2] = 10;
+    ASSERT_EQ(ptr0[4], 10);
+    auto view1 = view0.subview(1, 2);
+    ASSERT_EQ(view1[1], 10);
+    auto view2 = ptr0.subview(6, 0);
+    ASSERT_EQ(view2.size(), 0);
+    ASSERT_THROWS(ptr0.subview(7, 0));
+    ASSERT_THROWS(ptr0.subview(2, 5));
+    ASSERT_THROWS(view0.subview(0, 4));
+
+    // copies own their memory, moves are still subviews
+    auto copy0 = view0;
+    ASSERT_DIFF(copy0.data(), view0.data());
+    copy0.free();
+    auto view3 = std::move(view1);
+    ASSERT_EQ(view3[0], 4);
+
+    // subviews of views are plain views
+    auto view4 = fz::SafePtr<int>::make_view(ptr0.data(), 6).subview(1, 1);
+    ASSERT_EQ(view4[0], 2);
+
+    // the alignment is kept
+    fz::SafePtr<double, 32> ptr1(16, 1.0);
+    auto view5 = ptr1.subview(4, 8);
+    ASSERT_EQ(view5[7], 1.0);
+    ASSERT_THROWS(ptr1.subview(1, 8));
+
+    // subviews can outlive the SafePtr that owned the memory
+    fz::SafePtr<std::string> view6;
+    {
+        fz::SafePtr<std::string> ptr2(3, "abc");
+        view6 = ptr2.subview(1, 2);
+        ASSERT_EQ(view6[1], "abc");
+        ptr2.free();
+    }
+
+    // subviews of const SafePtrs can only be read
+    const fz::SafePtr<int> ptr3 = {7, 8, 9};
+    auto view8 = ptr3.subview(1, 2);
+    static_assert(
+        std::is_same<decltype(view8[0]), const int&>::value,
+        "subviews of const SafePtrs must be read only"
+    );
+    ASSERT_EQ(view8.data(), ptr3.data() + 1);
+    ASSERT_EQ(view8[1], 9);
+    ASSERT_EQ(view8.subview(1, 1)[0], 9);
+    ASSERT_THROWS(ptr3.subview(2, 2));
+
+    #ifdef SAFE_PTR_DEBUG
+        // subviews are checked for use after free, and can not free memory
+        ASSERT_THROWS(view0.free());
+        ASSERT_THROWS(view0.resize(4));
+        ASSERT_WARNS(view6[0]);
+        ASSERT_WARNS(view6.size());
+        ptr0.free();
+        ASSERT_WARNS(view0[0]);
+        ASSERT_WARNS(view3.data());
+        ASSERT_WARNS(ptr0.subview(0, 1));
+        ASSERT_EQ(view4.size(), 1); // plain views are not checked
+        ptr1.free();
+        ASSERT_WARNS(view5[0]);
+        ptr3.free();
+        ASSERT_WARNS(view8[0]);
+
+        // memory that is never freed is still reported as leaked, when the
+        // last subview is destroyed
+        auto leaked = new fz::SafePtr<int>(4);
+        auto view7 = new fz::SafePtr<int>(leaked->subview(0, 2));
+        delete leaked;
+        ASSERT_WARNS(delete view7);
+        const auto* const leaked_const = new const fz::SafePtr<int>(4);
+        auto view9 = new fz::SafePtr<const int>(leaked_const->subview(0, 2));
+        delete leaked_const;
+        ASSERT_WARNS(delete view9);
+
+        // whether a SafePtr is a subview is kept in its memory id
+        ASSERT_EQ(sizeof(fz::SafePtr<int>), 3 * sizeof(int*));
+    #else
+        ptr0.free();
+        ptr1.free();
+        ptr3.free();
+    #endif
+}
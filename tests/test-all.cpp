@@ -8,25 +8,77 @@
 #include "methods.hpp"
 #include "ref-count.hpp"
 #include "print.hpp"
+#include "checked.hpp"
+#include "construction.hpp"
+#include "alignment.hpp"
+#include "large-alloc.hpp"
+#include "arena.hpp"
+#include "pool.hpp"
+#include "map-file.hpp"
+#include "first-touch.hpp"
+#include "fill-copy.hpp"
+#include "resize.hpp"
+#include "input-range.hpp"
+#include "subview.hpp"
+#include "nd-view.hpp"
+#include "soa.hpp"
+#include "parallel.hpp"
+#include "serialization.hpp"
+#include "allocation-site.hpp"
+#include "sampling.hpp"
+#include "stats.hpp"
+#include "quarantine.hpp"
 
 #define TEST_PRINT 0
 
 int main()
 {
     std::cout << "========================================\n";
-    #ifdef SAFE_PTR_DEBUG
+    #if defined(SAFE_PTR_DEBUG) && defined(SAFE_PTR_DEBUG_SAMPLE_RATE)
+        std::cout << "Testing with SAFE_PTR_DEBUG mode ON (sampled):\n";
+    #elif defined(SAFE_PTR_DEBUG) && defined(SAFE_PTR_DEBUG_QUARANTINE)
+        std::cout << "Testing with SAFE_PTR_DEBUG mode ON (quarantine):\n";
+    #elif defined(SAFE_PTR_DEBUG) && defined(SAFE_PTR_DEBUG_INLINE_HEADER)
+        std::cout << "Testing with SAFE_PTR_DEBUG mode ON (inline header):\n";
+    #elif defined(SAFE_PTR_DEBUG)
         std::cout << "Testing with SAFE_PTR_DEBUG mode ON:\n";
+    #elif defined(SAFE_PTR_STATS)
+        std::cout << "Testing with SAFE_PTR_DEBUG mode OFF (stats):\n";
     #else
         std::cout << "Testing with SAFE_PTR_DEBUG mode OFF:\n";
     #endif
     try {
+    #ifndef SAFE_PTR_DEBUG_SAMPLE_RATE
+        // the other tests expect every allocation to be tracked
         test_rule_of_5();
         test_view();
         test_methods();
         test_ref_count();
+        test_checked();
+        test_construction();
+        test_alignment();
+        test_large_alloc();
+        test_arena();
+        test_pool();
+        test_map_file();
+        test_first_touch();
+        test_fill_copy();
+        test_resize();
+        test_input_range();
+        test_subview();
+        test_nd_view();
+        test_soa();
+        test_parallel();
+        test_serialization();
+        test_allocation_site();
+        test_stats();
+        test_quarantine();
+        test_print_format();
         #if TEST_PRINT
             test_print();
         #endif
+    #endif
+        test_sampling();
         std::cout << COLOR_GREEN << "Test passed" << COLOR_RESET << "\n";
     } catch (const fz::_SafePtrWarning& e) {
         std::cerr << COLOR_RED << "TEST FAILED: " << COLOR_RESET <<